@@ -0,0 +1,133 @@
+#ifndef __ANALYZER_HPP__
+#define __ANALYZER_HPP__
+
+#include "common.hpp"
+#include "RobotPlayer.hpp"
+#include "ThreadPool.hpp"
+
+namespace mfwu {
+
+/*
+    batch evaluation for analysis jobs: positions in (from archives,
+    datasets, ...), the robot's answer for each out, no game around them
+    the batch is cut into chunks over a ThreadPool, one HumanLikeRobot
+    per chunk since a search keeps its deduction board in the robot
+    ties are broken by a generator seeded from each request, so a result
+    never depends on the chunk, the worker or the timing that ran it
+*/
+
+struct AnalysisRequest {
+    std::vector<std::vector<size_t>> board;  // statuses, square, 7 to 32 (is_valid_board_size)
+    Piece::Color color = Piece::Color::Black;  // the side to move
+    size_t top_k = 0;  // candidates to return, the best move included
+    size_t num_lines = 0;  // multi-pv: ranked lines to return, from the same search
+};  // endof struct AnalysisRequest
+
+struct AnalysisCandidate {
+    int row = -1;
+    int col = -1;
+    float score = 0;
+};  // endof struct AnalysisCandidate
+
+struct AnalysisResult {
+    bool ok = false;  // false: bad size, or no move left
+    int row = -1;
+    int col = -1;
+    float score = 0;
+    int depth = 0;
+    std::vector<AnalysisCandidate> candidates;  // best first, at most top_k
+    std::vector<SearchLine> lines;  // best first, at most num_lines
+};  // endof struct AnalysisResult
+
+class Analyzer {
+public:
+    static constexpr size_t default_chunk = 16;  // positions per task
+
+    explicit Analyzer(size_t workers=std::thread::hardware_concurrency(),
+                      const HumanLikeConfig& config=HumanLikeConfig{},
+                      size_t chunk=default_chunk)
+        : pool_(workers), config_(config), chunk_(std::max<size_t>(chunk, 1)) {}
+
+    size_t get_workers() const { return pool_.size(); }
+    const HumanLikeConfig& get_config() const { return config_; }
+
+    // results in the order of reqs, blocks until all are done
+    std::vector<AnalysisResult> evaluate(const std::vector<AnalysisRequest>& reqs) {
+        std::vector<AnalysisResult> ret(reqs.size());
+        std::vector<std::future<void>> futures;
+        futures.reserve(reqs.size() / chunk_ + 1);
+        for (size_t beg = 0; beg < reqs.size(); beg += chunk_) {
+            size_t end = std::min(beg + chunk_, reqs.size());
+            futures.emplace_back(pool_.submit([this, &reqs, &ret, beg, end]() {
+                HumanLikeRobot robot;
+                robot.set_config(config_);
+                for (size_t i = beg; i < end; i++) {
+                    ret[i] = evaluate_one(robot, reqs[i]);
+                }
+            }));
+        }
+        for (std::future<void>& f : futures) { f.get(); }
+        return ret;
+    }
+    // on the calling thread
+    AnalysisResult evaluate(const AnalysisRequest& req) const {
+        HumanLikeRobot robot;
+        robot.set_config(config_);
+        return evaluate_one(robot, req);
+    }
+
+private:
+    // FNV-1a over the position and the side to move
+    static uint32_t seed_of(const AnalysisRequest& req) {
+        uint32_t h = 2166136261U;
+        auto feed = [&h](size_t v) { h = (h ^ static_cast<uint32_t>(v)) * 16777619U; };
+        for (const auto& line : req.board) {
+            for (size_t s : line) { feed(s); }
+        }
+        feed(static_cast<size_t>(req.color));
+        return h;
+    }
+    static AnalysisResult evaluate_one(HumanLikeRobot& robot, const AnalysisRequest& req) {
+        AnalysisResult ret;
+        robot.set_seed(seed_of(req));
+        std::vector<std::vector<float>> heatmap;
+        auto [score, row, col] = robot.analyze(req.board, req.color, req.top_k ? &heatmap : nullptr,
+                                               req.num_lines ? &ret.lines : nullptr, req.num_lines);
+        if (row < 0 || col < 0) { return ret; }
+        ret.ok = true;
+        ret.row = row;
+        ret.col = col;
+        ret.score = score;
+        ret.depth = robot.get_last_depth();
+        if (req.top_k == 0) { return ret; }
+        std::vector<AnalysisCandidate> cands;
+        cands.reserve(heatmap.size() * heatmap.size());
+        for (size_t r = 0; r < heatmap.size(); r++) {
+            for (size_t c = 0; c < heatmap[r].size(); c++) {
+                if (req.board[r][c] != 0) { continue; }
+                cands.push_back({(int)r, (int)c, heatmap[r][c]});
+            }
+        }
+        // the chosen move first even if a sibling ties it
+        auto best = std::find_if(cands.begin(), cands.end(), [row=row, col=col](const AnalysisCandidate& a) {
+            return a.row == row && a.col == col;
+        });
+        if (best == cands.end()) { return ret; }
+        best->score = score;
+        std::iter_swap(cands.begin(), best);
+        size_t k = std::min(req.top_k, cands.size());
+        std::partial_sort(cands.begin() + 1, cands.begin() + k, cands.end(),
+            [](const AnalysisCandidate& a, const AnalysisCandidate& b) { return a.score > b.score; });
+        cands.resize(k);
+        ret.candidates = std::move(cands);
+        return ret;
+    }
+
+    ThreadPool pool_;
+    HumanLikeConfig config_;
+    size_t chunk_;
+};  // endof class Analyzer
+
+}  // endof namespace mfwu
+
+#endif  // __ANALYZER_HPP__
@@ -3,9 +3,23 @@
 
 #include "common.hpp"
 #include "Logger.hpp"
+#include "ArchiveWriter.hpp"
 
 namespace mfwu {
 
+#ifdef __ARCHIVE_SEGMENT__
+// one rolling segment per run, shared by every archive of the process
+inline const std::string& get_run_segment_name() {
+    static const std::string name = [](){
+        std::string str;
+        append_time_info(str);
+        str += ".seg";
+        return str;
+    }();
+    return name;
+}
+#endif  // __ARCHIVE_SEGMENT__
+
 /*
     only for game archive now
     we can develop it further to
@@ -28,12 +42,17 @@ public:
     using Seq_type = Seq_t;
     using Tbl_type = Tbl_t;
     static constexpr const char* dir = "./archive";
-    Archive_base(const std::string& archive_filename="") {
+    Archive_base(const std::string& archive_filename="") 
+        : archive_filename_(archive_filename) {
         if (archive_filename == std::string("")) {
             std::string str = dir;
             str += '/'; 
+#ifdef __ARCHIVE_SEGMENT__
+            str += get_run_segment_name();
+#else  // !__ARCHIVE_SEGMENT__
             append_time_info(str);
             str += ".arc";
+#endif  // __ARCHIVE_SEGMENT__
             archive_filename_ = str;
             if (!std::filesystem::exists(dir)) {
                 status_ = std::filesystem::create_directories(dir);
@@ -43,14 +62,9 @@ public:
                 }
             }
         }
-        // if dir doesnt exist, fs_ wont create and open the file
-        fs_.open(archive_filename_, std::ios::app);
-    }
-    ~Archive_base() {
-        if (fs_.is_open()) {
-            fs_.close();
-        }
+        // the file is created by ArchiveWriter on the first flush
     }
+    ~Archive_base() {}
     virtual void init_game() = 0;
     virtual void init_game(const Tbl_type& board) = 0;
     virtual void record(const Seq_type& seq) = 0;
@@ -65,18 +79,26 @@ public:
 
 
     // warning: will destroy all the frames!
+    // frames are moved to ArchiveWriter, no io on the game thread
     void flush(GameStatus status) {
+        ArchiveGameRecord rec;
+        rec.filename = archive_filename_;
+        rec.frames.reserve(this->frames_.size());
         for (Frame& frame : this->frames_) {
-            this->flush_frame(frame);
+            rec.frames.emplace_back(std::move(frame.get_seq()));
         }
-        this->flush_log(status);
-        this->fs_.flush();  // flush once after a game
+        rec.tail = get_tail(status);
+        ArchiveWriter::Instance().submit(std::move(rec));
 
         // reinit for next game
         this->init_game();
     }
+    // wait until the flushed games reach the file
+    void sync() {
+        ArchiveWriter::Instance().sync();
+    }
     bool get_status() const {
-        return status_;
+        return status_ && ArchiveWriter::Instance().get_status();
     }
 
 protected:
@@ -186,20 +208,12 @@ protected:
         }
     };  // endof struct Frame
 
-    void flush_log(GameStatus status) {
-        if (!fs_.is_open()) {
-            fs_.open(archive_filename_, std::ios::app);
-        }
-        fs_ << "[XQ4GB-SEP]\n"
-            << "This game end with status:" 
-            << GameStatusDescription.at(static_cast<size_t>(status))
-            << "\n\n";
-    }
-    void flush_frame(Frame& frame) {
-        if (!fs_.is_open()) {
-            fs_.open(archive_filename_, std::ios::app);
-        }
-        fs_ << std::move(frame.get_seq()) << "\n";
+    static std::string get_tail(GameStatus status) {
+        std::string tail = "[XQ4GB-SEP]\n";
+        tail += "This game end with status:";
+        tail += GameStatusDescription.at(static_cast<size_t>(status));
+        tail += "\n\n";
+        return tail;
     }
     static void remove_sp(Tbl_type& tbl) {
         bool found_sp_flag = false;
@@ -226,7 +240,6 @@ protected:
     std::vector<Frame> frames_;
 private:
     std::string archive_filename_;
-    std::fstream fs_;
     bool status_ = true;
 };  // endof class Archive_base
 
@@ -386,7 +399,7 @@ public:
                         this->frames_.back().get_tbl()[i][j]--;
                         log_warn("Multiple sp pieces found in init_game()");
                     } else {
-                        p = Piece{i, j, Piece::Color{status}};
+                        p = Piece{i, j, static_cast<Piece::Color>(status)};
                         found_sp_flag = true;
                     }
                 }
@@ -430,7 +443,7 @@ private:
                         log_error("Multiple sp pieces found in update_last_move()");
                         log_error(XQ4GB_TIMESTAMP, "frames_ may has been broken");
                     } else {
-                        this->moves_.emplace_back(i, j, Piece::Color{new_board[i][j]});
+                        this->moves_.emplace_back(i, j, static_cast<Piece::Color>(new_board[i][j]));
                         found_sp_flag = true;
                     }
                 }
@@ -0,0 +1,150 @@
+#ifndef __ARCHIVEREADER_HPP__
+#define __ARCHIVEREADER_HPP__
+
+#include "common.hpp"
+#include "Segment.hpp"
+
+namespace mfwu {
+
+/*
+    reads back what Archive_base::flush() writes:
+        one board per frame ("0 0 3 ..." rows + a blank line),
+        then "[XQ4GB-SEP]" and "This game end with status:XXX"
+    a frame only differs from the previous one by its sp piece,
+    so a game is kept as its move list instead of full boards
+*/
+struct ArchiveGame {
+    size_t size = 0;
+    std::vector<PackedMove> moves;  // real colors, 2 bytes a move
+    GameStatus status = GameStatus::INVALID;
+
+    // Black / White for a five, Invalid for a draw,
+    // nullopt if the game was abandoned (RESTART, MENU, QUIT...)
+    std::optional<Piece::Color> result() const {
+        if (status != GameStatus::NORMAL || moves.empty()) { return std::nullopt; }
+        std::vector<size_t> board(size * size, 0);
+        for (PackedMove p : moves) {
+            board[p.row() * size + p.col()] = p.get_real_status();
+        }
+        const Piece last = moves.back().to_piece();
+        for (auto&& [inc_r, inc_c] : half_dirs) {
+            size_t cnt = 1;
+            for (int sign : {1, -1}) {
+                int r = last.row + sign * inc_r, c = last.col + sign * inc_c;
+                while (r >= 0 && r < (int)size && c >= 0 && c < (int)size
+                       && board[r * size + c] == last.get_real_status()) {
+                    cnt++;
+                    r += sign * inc_r; c += sign * inc_c;
+                }
+            }
+            if (cnt >= NoPtW) { return last.color; }
+        }
+        return Piece::Color::Invalid;  // draw
+    }
+};  // endof struct ArchiveGame
+
+class ArchiveReader {
+public:
+    static constexpr const char* sep_line = "[XQ4GB-SEP]";
+    static constexpr const char* status_prefix = "This game end with status:";
+
+    // the stream is not owned, keep it alive while reading
+    ArchiveReader(std::istream& is) : is_(is) {}
+
+    // false at eof, games with broken frames are still returned
+    // with the moves read so far
+    bool next(ArchiveGame& game) {
+        game = ArchiveGame{};
+        std::vector<size_t> row;
+        size_t rows = 0;
+        Piece sp = invalid_piece;
+        while (std::getline(is_, line_)) {
+            if (line_.empty()) {  // end of a frame
+                if (rows) {
+                    if (game.size == 0) { game.size = rows; }
+                    if (sp.get_status() != 0) { game.moves.push_back(sp); }
+                    else { broken_frames_++; }
+                }
+                rows = 0;
+                sp = invalid_piece;
+            } else if (line_ == sep_line) {
+                if (std::getline(is_, line_)
+                    && line_.compare(0, strlen(status_prefix), status_prefix) == 0) {
+                    game.status = parse_status(line_.substr(strlen(status_prefix)));
+                }
+                return true;
+            } else if (is_digit(line_[0])) {
+                int col = 0;
+                for (char ch : line_) {
+                    if (!is_digit(ch)) { continue; }
+                    size_t status = ch - '0';
+                    if (status == static_cast<size_t>(Piece::Color::WhiteSp)
+                        || status == static_cast<size_t>(Piece::Color::BlackSp)) {
+                        sp = Piece{(int)rows, col, static_cast<Piece::Color>(Piece::get_real_status(status))};
+                    }
+                    col++;
+                }
+                rows++;
+            }
+        }
+        // trailing game without a separator, e.g. a killed process
+        return game.size != 0;
+    }
+    size_t get_broken_frames() const { return broken_frames_; }
+
+private:
+    static GameStatus parse_status(const std::string& str) {
+        for (auto&& [idx, desc] : GameStatusDescription) {
+            if (desc == str) { return GameStatus{idx}; }
+        }
+        return GameStatus::INVALID;
+    }
+
+    std::istream& is_;
+    std::string line_;
+    size_t broken_frames_ = 0;
+};  // endof class ArchiveReader
+
+// an .arc or .seg file opened for reading, segments are detected by magic
+class ArchiveFile {
+public:
+    ArchiveFile(const std::string& filename)
+        : ifs_(filename, std::ios::in | std::ios::binary), is_(ifs_.rdbuf()) {
+        if (!ifs_.is_open()) {
+            is_.setstate(std::ios::badbit);
+            return ;
+        }
+        if (Segment::is_segment(ifs_)) {
+            seg_buf_ = std::make_unique<SegmentStreamBuf>(ifs_);
+            is_.rdbuf(seg_buf_.get());
+        }
+    }
+    bool is_open() const { return ifs_.is_open(); }
+    std::istream& stream() { return is_; }
+
+    static bool is_archive(const std::filesystem::path& path) {
+        std::string ext = path.extension().string();
+        return ext == std::string(".arc") || ext == std::string(".seg");
+    }
+    // every archive in dir, sorted by name (and so by time)
+    static std::vector<std::string> list_dir(const std::string& dir) {
+        std::vector<std::string> ret;
+        if (!std::filesystem::exists(dir)) { return ret; }
+        for (const auto& file : std::filesystem::directory_iterator(dir)) {
+            if (file.is_regular_file() && is_archive(file.path())) {
+                ret.push_back(file.path().string());
+            }
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+private:
+    std::ifstream ifs_;
+    std::istream is_;
+    std::unique_ptr<SegmentStreamBuf> seg_buf_ = nullptr;
+};  // endof class ArchiveFile
+
+}  // endof namespace mfwu
+
+#endif  // __ARCHIVEREADER_HPP__
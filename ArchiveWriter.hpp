@@ -0,0 +1,301 @@
+#ifndef __ARCHIVEWRITER_HPP__
+#define __ARCHIVEWRITER_HPP__
+
+#include "common.hpp"
+#include "Segment.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+
+namespace mfwu {
+
+/*
+    background writer for finished games
+    the game thread only moves its frames into the queue,
+    the writer thread coalesces every queued game of the same
+    file into one writev() and fsyncs according to the policy
+    a ".seg" filename turns the file into a rolling segment:
+    every batch becomes one compressed block (see Segment.hpp)
+    and the file rolls over to "<name>.1.seg", "<name>.2.seg"...
+    once it grows over segment_max_bytes
+*/
+enum class FsyncPolicy : size_t {
+    NEVER    = 0,  // leave it to the page cache
+    BATCH    = 1,  // fsync after every coalesced write
+    GAMES    = 2,  // fsync once every `fsync_param_` games
+    INTERVAL = 3   // fsync at most once every `fsync_param_` ms
+};  // endof enum class FsyncPolicy
+
+// the policy a binary starts with, define before including anything:
+//   #define __ARCHIVE_FSYNC__ 2  : FsyncPolicy::GAMES
+//   #define __ARCHIVE_FSYNC_PARAM__ 10  : every 10 games
+// or at run time with set_fsync_policy (serv -f)
+#ifndef __ARCHIVE_FSYNC__
+#define __ARCHIVE_FSYNC__ 0
+#endif  // __ARCHIVE_FSYNC__
+#ifndef __ARCHIVE_FSYNC_PARAM__
+#define __ARCHIVE_FSYNC_PARAM__ 0
+#endif  // __ARCHIVE_FSYNC_PARAM__
+
+struct ArchiveGameRecord {
+    std::string filename;
+    std::vector<std::string> frames;  // one serialized board per frame
+    std::string tail;                 // end-of-game separator
+};  // endof struct ArchiveGameRecord
+
+class ArchiveWriter {
+public:
+    static constexpr size_t batch_games = 16;   // write as soon as this many games are queued
+    static constexpr size_t linger_ms   = 200;  // otherwise wait at most this long for more games
+    static constexpr size_t segment_max_bytes = 1UL << 26;
+
+    static ArchiveWriter& Instance() {
+        static ArchiveWriter writer;
+        return writer;
+    }
+
+    // never blocks on io, the record is moved into the queue
+    void submit(ArchiveGameRecord&& rec) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            queue_.emplace_back(std::move(rec));
+            submitted_++;
+        }
+        cv_.notify_one();
+    }
+    // blocks until everything submitted before the call has been written,
+    // use it before exec() or anything else that skips the destructors
+    void sync() {
+        std::unique_lock<std::mutex> lk(mtx_);
+        size_t target = submitted_;
+        if (written_ >= target) { return ; }
+        force_ = true;
+        cv_.notify_one();
+        done_cv_.wait(lk, [&]() { return written_ >= target; });
+    }
+    void set_fsync_policy(FsyncPolicy policy, size_t param=0) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        policy_ = policy;
+        fsync_param_ = param;
+    }
+    bool get_status() const {
+        return status_.load();
+    }
+
+private:
+    ArchiveWriter() : worker_(&ArchiveWriter::writer_task, this) {}
+    ~ArchiveWriter() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        for (auto&& [_, sink] : sinks_) {
+            ::fsync(sink.fd);
+            ::close(sink.fd);
+        }
+    }
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+
+    void writer_task() {
+        std::deque<ArchiveGameRecord> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [this]() { return stop_ || !queue_.empty(); });
+                // group flush: give other games a chance to join this write
+                cv_.wait_for(lk, std::chrono::milliseconds(linger_ms), [this]() {
+                    return stop_ || force_ || queue_.size() >= batch_games;
+                });
+                if (queue_.empty() && stop_) { break; }
+                force_ = false;
+                std::swap(batch, queue_);
+            }
+            size_t num = batch.size();
+            write_batch(batch);
+            batch.clear();
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                written_ += num;
+            }
+            done_cv_.notify_all();
+        }
+    }
+
+    struct Sink {
+        int fd = -1;
+        size_t bytes = 0;   // current size of the file behind fd
+        size_t index = 0;   // rolling index, segments only
+    };  // endof struct Sink
+
+    static bool is_segment(std::string_view filename) {
+        return filename.size() > 4 && filename.substr(filename.size() - 4) == ".seg";
+    }
+    static std::string get_segment_name(const std::string& filename, size_t index) {
+        if (index == 0) { return filename; }
+        return filename.substr(0, filename.size() - 4) + '.' + std::to_string(index) + ".seg";
+    }
+
+    void write_batch(std::deque<ArchiveGameRecord>& batch) {
+        static const char newline = '\n';
+        // games of the same file are written in submission order
+        std::vector<std::string_view> files;
+        for (const ArchiveGameRecord& rec : batch) {
+            if (std::find(files.begin(), files.end(), rec.filename) == files.end()) {
+                files.emplace_back(rec.filename);
+            }
+        }
+        for (const std::string_view& filename : files) {
+            Sink* sink = get_sink(std::string(filename));
+            if (sink == nullptr) { continue; }
+            if (is_segment(filename)) {
+                write_segment(*sink, std::string(filename), batch);
+                continue;
+            }
+            std::vector<iovec> iov;
+            size_t games = 0;
+            for (ArchiveGameRecord& rec : batch) {
+                if (rec.filename != filename) { continue; }
+                for (std::string& frame : rec.frames) {
+                    iov.push_back({frame.data(), frame.size()});
+                    iov.push_back({const_cast<char*>(&newline), 1});
+                }
+                iov.push_back({rec.tail.data(), rec.tail.size()});
+                games++;
+            }
+            sink->bytes += write_all(sink->fd, iov);
+            games_since_sync_ += games;
+            maybe_fsync(sink->fd);
+        }
+    }
+    void write_segment(Sink& sink, const std::string& filename,
+                       std::deque<ArchiveGameRecord>& batch) {
+        std::string raw;
+        size_t games = 0;
+        for (ArchiveGameRecord& rec : batch) {
+            if (rec.filename != filename) { continue; }
+            for (std::string& frame : rec.frames) {
+                raw += frame;
+                raw += '\n';
+            }
+            raw += rec.tail;
+            games++;
+        }
+        std::string out;
+        if (sink.bytes == 0) { out = Segment::file_header(); }
+        Segment::encode(raw.data(), raw.size(), out);
+        std::vector<iovec> iov = {{out.data(), out.size()}};
+        sink.bytes += write_all(sink.fd, iov);
+        games_since_sync_ += games;
+        maybe_fsync(sink.fd);
+        if (sink.bytes >= segment_max_bytes) {  // roll over
+            ::fsync(sink.fd);
+            ::close(sink.fd);
+            sink.index++;
+            sink.fd = open_file(get_segment_name(filename, sink.index), sink.bytes);
+            if (sink.fd < 0) { sinks_.erase(filename); }
+        }
+    }
+    size_t write_all(int fd, std::vector<iovec>& iov) {
+        size_t idx = 0, total = 0;
+        while (idx < iov.size()) {
+            int cnt = static_cast<int>(std::min<size_t>(iov.size() - idx, IOV_MAX));
+            ssize_t n = ::writev(fd, iov.data() + idx, cnt);
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                std::cerr << "archive writer: writev fails, games may be lost\n";
+                status_ = false;
+                return total;
+            }
+            total += n;
+            // skip what has been written, partial iovecs are advanced in place
+            while (idx < iov.size() && n >= static_cast<ssize_t>(iov[idx].iov_len)) {
+                n -= iov[idx].iov_len;
+                idx++;
+            }
+            if (n > 0) {
+                iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + n;
+                iov[idx].iov_len -= n;
+            }
+        }
+        return total;
+    }
+    void maybe_fsync(int fd) {
+        FsyncPolicy policy;
+        size_t param;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            policy = policy_;
+            param = fsync_param_;
+        }
+        bool need_sync = false;
+        auto now = std::chrono::steady_clock::now();
+        switch (policy) {
+        case FsyncPolicy::NEVER : {
+        } break;
+        case FsyncPolicy::BATCH : {
+            need_sync = true;
+        } break;
+        case FsyncPolicy::GAMES : {
+            need_sync = games_since_sync_ >= std::max<size_t>(param, 1);
+        } break;
+        case FsyncPolicy::INTERVAL : {
+            need_sync = now - last_sync_ >= std::chrono::milliseconds(param);
+        } break;
+        default :
+            need_sync = true;
+        }
+        if (need_sync) {
+            ::fdatasync(fd);
+            games_since_sync_ = 0;
+            last_sync_ = now;
+        }
+    }
+    Sink* get_sink(const std::string& filename) {
+        auto it = sinks_.find(filename);
+        if (it != sinks_.end()) { return &it->second; }
+        Sink sink;
+        sink.fd = open_file(filename, sink.bytes);
+        if (sink.fd < 0) { return nullptr; }
+        return &sinks_.emplace(filename, sink).first->second;
+    }
+    int open_file(const std::string& filename, size_t& bytes) {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "archive writer: cannot open " << filename << "\n";
+            status_ = false;
+            return -1;
+        }
+        struct stat st;
+        bytes = ::fstat(fd, &st) == 0 ? st.st_size : 0;
+        return fd;
+    }
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    std::deque<ArchiveGameRecord> queue_;
+    size_t submitted_ = 0;
+    size_t written_ = 0;
+    bool force_ = false;
+    bool stop_ = false;
+    FsyncPolicy policy_ = FsyncPolicy{__ARCHIVE_FSYNC__};
+    size_t fsync_param_ = __ARCHIVE_FSYNC_PARAM__;
+
+    // only touched by the writer thread
+    std::unordered_map<std::string, Sink> sinks_;
+    size_t games_since_sync_ = 0;
+    std::chrono::steady_clock::time_point last_sync_ = std::chrono::steady_clock::now();
+    std::atomic<bool> status_ = true;
+
+    std::thread worker_;  // keep it the last member, it starts in the init list
+};  // endof class ArchiveWriter
+
+}  // endof namespace mfwu
+
+#endif  // __ARCHIVEWRITER_HPP__
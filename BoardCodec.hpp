@@ -0,0 +1,161 @@
+#ifndef __BOARDCODEC_HPP__
+#define __BOARDCODEC_HPP__
+
+#include "common.hpp"
+
+namespace mfwu {
+
+/*
+    packed board for the inference log, tagged '#' (zip_tbl's '*' and ':' are still read)
+    one line of base64 digits, no spaces, no '%', so it goes through log_infer as is
+
+        V M S body        V: version (1), M: 0 dense / 1 sparse, S: board size (<= 32)
+        dense : K (2 digits), K * 2 digits (index of each sp cell), then the grid,
+                2 bits per cell (0 empty, 1 white, 2 black), 3 cells per digit
+        sparse: 2 digits per stone, index << 2 | (status - 1), so sp comes for free
+
+    the encoder takes whichever body is shorter: early boards are sparse,
+    late ones dense. both sides are table lookups over flat arrays, no branches
+    on the cell values in the hot loops
+*/
+class BoardCodec {
+public:
+    static constexpr size_t version = 1;
+    static constexpr size_t max_size = 32;  // sparse index fits in 10 bits
+    static constexpr size_t header_len = 3;
+
+    // board: statuses 0..4 (Piece::Color)
+    static std::string encode(const std::vector<std::vector<size_t>>& board) {
+        const size_t n = board.size();
+        std::string ret;
+        if (n == 0 || n > max_size) { return ret; }
+        size_t stones = 0, sps = 0;
+        for (const auto& line : board) {
+            for (size_t s : line) {
+                stones += s != 0;
+                sps += is_sp(s);
+            }
+        }
+        size_t dense_len = 2 + 2 * sps + (n * n + 2) / 3;
+        bool sparse = 2 * stones < dense_len;
+        ret.reserve(header_len + (sparse ? 2 * stones : dense_len));
+        ret += digits()[version];
+        ret += digits()[sparse];
+        ret += digits()[n];
+        if (sparse) {
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = 0; j < n; j++) {
+                    size_t s = board[i][j];
+                    if (s == 0) { continue; }
+                    put12(ret, ((i * n + j) << 2) | (s - 1));
+                }
+            }
+            return ret;
+        }
+        put12(ret, sps);
+        std::vector<uint8_t> cells(n * n + 2, 0);  // padded to a multiple of 3
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < n; j++) {
+                size_t s = board[i][j] < 5 ? board[i][j] : 0;
+                cells[i * n + j] = cell_code()[s];
+                if (is_sp(s)) { put12(ret, i * n + j); }
+            }
+        }
+        size_t off = ret.size();
+        ret.resize(off + (n * n + 2) / 3);
+        for (size_t k = 0, d = off; k < n * n; k += 3, d++) {
+            ret[d] = digits()[cells[k] | cells[k + 1] << 2 | cells[k + 2] << 4];
+        }
+        return ret;
+    }
+
+    // flat row-major statuses, false (and `out` untouched) if `str` is broken
+    static bool decode(std::string_view str, std::vector<uint8_t>& out, size_t& n) {
+        if (str.size() < header_len) { return false; }
+        int v = value(str[0]), mode = value(str[1]), sz = value(str[2]);
+        if (v != (int)version || mode < 0 || mode > 1 || sz <= 0 || sz > (int)max_size) {
+            return false;
+        }
+        std::vector<uint8_t> cells(sz * sz + 2, 0);
+        size_t p = header_len;
+        if (mode == 1) {  // sparse
+            if ((str.size() - p) % 2) { return false; }
+            for (; p < str.size(); p += 2) {
+                int val = get12(str, p);
+                if (val < 0 || (size_t)(val >> 2) >= (size_t)(sz * sz)) { return false; }
+                cells[val >> 2] = (val & 3) + 1;
+            }
+        } else {
+            int k = get12(str, p);
+            p += 2;
+            if (k < 0 || str.size() != p + 2 * k + (sz * sz + 2) / 3) { return false; }
+            size_t sp_at = p;
+            p += 2 * k;
+            const auto& lut = grid_lut();
+            for (size_t c = 0; p < str.size(); p++, c += 3) {
+                int d = value(str[p]);
+                if (d < 0) { return false; }
+                cells[c]     = lut[d][0];
+                cells[c + 1] = lut[d][1];
+                cells[c + 2] = lut[d][2];
+            }
+            for (int i = 0; i < k; i++, sp_at += 2) {
+                int idx = get12(str, sp_at);
+                if (idx < 0 || idx >= sz * sz || cells[idx] == 0) { return false; }
+                cells[idx]++;  // 1 -> 2, 3 -> 4
+            }
+        }
+        cells.resize(sz * sz);
+        out.swap(cells);
+        n = sz;
+        return true;
+    }
+
+private:
+    static bool is_sp(size_t s) {
+        return s == static_cast<size_t>(Piece::Color::WhiteSp)
+            || s == static_cast<size_t>(Piece::Color::BlackSp);
+    }
+    // status -> 2-bit code, sp folds into its color
+    static const std::array<uint8_t, 5>& cell_code() {
+        static const std::array<uint8_t, 5> t = {0, 1, 1, 2, 2};
+        return t;
+    }
+    static const char* digits() {
+        return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    }
+    static int value(char c) {
+        static const std::array<int8_t, 256> t = [](){
+            std::array<int8_t, 256> ret;
+            ret.fill(-1);
+            for (int i = 0; i < 64; i++) { ret[static_cast<uint8_t>(digits()[i])] = i; }
+            return ret;
+        }();
+        return t[static_cast<uint8_t>(c)];
+    }
+    // digit -> the 3 statuses it holds (sp not applied yet)
+    static const std::array<std::array<uint8_t, 3>, 64>& grid_lut() {
+        static const std::array<std::array<uint8_t, 3>, 64> t = [](){
+            static constexpr uint8_t status[4] = {0, 1, 3, 0};  // code 3 is never written
+            std::array<std::array<uint8_t, 3>, 64> ret;
+            for (int d = 0; d < 64; d++) {
+                ret[d] = {status[d & 3], status[(d >> 2) & 3], status[(d >> 4) & 3]};
+            }
+            return ret;
+        }();
+        return t;
+    }
+    static void put12(std::string& str, size_t val) {
+        str += digits()[(val >> 6) & 63];
+        str += digits()[val & 63];
+    }
+    static int get12(std::string_view str, size_t p) {
+        if (p + 1 >= str.size()) { return -1; }
+        int hi = value(str[p]), lo = value(str[p + 1]);
+        return hi < 0 || lo < 0 ? -1 : hi << 6 | lo;
+    }
+};  // endof class BoardCodec
+
+}  // endof namespace mfwu
+
+#endif  // __BOARDCODEC_HPP__
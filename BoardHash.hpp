@@ -0,0 +1,97 @@
+#ifndef __BOARDHASH_HPP__
+#define __BOARDHASH_HPP__
+
+#include "common.hpp"
+
+namespace mfwu {
+
+/*
+    zobrist keys + the 8 symmetries of a square board
+    keys come from a fixed seed, hashes written to disk
+    stay valid between runs and builds
+*/
+class BoardHash {
+public:
+    static constexpr size_t max_size = 32;
+    static constexpr size_t num_of_syms = 8;
+
+    // color: real status, 1 (white) or 3 (black)
+    // off the table (search windows on sparse boards) the key is mixed on the fly
+    static uint64_t key(int row, int col, size_t color) {
+        size_t black = color == static_cast<size_t>(Piece::Color::Black);
+        if (static_cast<unsigned>(row) < max_size && static_cast<unsigned>(col) < max_size) {
+            return keys()[(row * max_size + col) * 2 + black];
+        }
+        uint64_t z = (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 33)
+                   ^ (static_cast<uint64_t>(static_cast<uint32_t>(col)) << 1) ^ black;
+        return mix(z + 0x58513447424F4152ULL);
+    }
+    static uint64_t side_key() { return keys().back(); }
+
+    // [r, c] under symmetry `sym` on a `size` x `size` board
+    static std::pair<int, int> transform(int r, int c, size_t size, size_t sym) {
+        int n = static_cast<int>(size) - 1;
+        switch (sym) {
+        case 0 : return {r, c};
+        case 1 : return {c, n - r};      // rot 90
+        case 2 : return {n - r, n - c};  // rot 180
+        case 3 : return {n - c, r};      // rot 270
+        case 4 : return {r, n - c};      // mirror
+        case 5 : return {n - r, c};      // flip
+        case 6 : return {c, r};          // transpose
+        case 7 : return {n - c, n - r};  // anti-transpose
+        default: return {r, c};
+        }
+    }
+    // inverse of transform(.., sym)
+    static size_t inverse(size_t sym) {
+        return sym == 1 ? 3 : sym == 3 ? 1 : sym;
+    }
+
+    // board: size * size real statuses in row-major order
+    template <typename Cell_t>
+    static uint64_t hash(const std::vector<Cell_t>& board, size_t size) {
+        uint64_t h = 0;
+        for (size_t i = 0; i < size * size; i++) {
+            if (board[i]) { h ^= key(i / size, i % size, Piece::get_real_status(board[i])); }
+        }
+        return h;
+    }
+    // min hash over the 8 symmetries, `sym` gets the symmetry that reaches it
+    template <typename Cell_t>
+    static uint64_t canonical_hash(const std::vector<Cell_t>& board, size_t size, size_t* sym=nullptr) {
+        std::array<uint64_t, num_of_syms> h = {};
+        for (size_t i = 0; i < size * size; i++) {
+            if (!board[i]) { continue; }
+            size_t color = Piece::get_real_status(board[i]);
+            for (size_t s = 0; s < num_of_syms; s++) {
+                auto [r, c] = transform(i / size, i % size, size, s);
+                h[s] ^= key(r, c, color);
+            }
+        }
+        size_t best = std::min_element(h.begin(), h.end()) - h.begin();
+        if (sym) { *sym = best; }
+        return h[best];
+    }
+
+private:
+    static const std::vector<uint64_t>& keys() {
+        static const std::vector<uint64_t> k = [](){
+            std::vector<uint64_t> ret(max_size * max_size * 2 + 1);
+            uint64_t seed = 0x58513447424F4152ULL;
+            for (uint64_t& v : ret) { v = mix(seed += 0x9E3779B97F4A7C15ULL); }
+            return ret;
+        }();
+        return k;
+    }
+    // splitmix64's finalizer
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};  // endof class BoardHash
+
+}  // endof namespace mfwu
+
+#endif  // __BOARDHASH_HPP__
@@ -28,11 +28,22 @@ public:
     // virtual void update(const Position& pos) = 0;
     virtual size_t size() const = 0;
     virtual size_t get_status(int row, int col) const = 0;
-    virtual Command get_command() = 0;
+    // input as events: a valid command, or nullopt if none came within timeout_ms
+    // bad input is reported and dropped here, the caller just polls again
+    virtual std::optional<Command> poll_command(int timeout_ms) = 0;
+    Command get_command() {
+        std::optional<Command> cmd;
+        while (!(cmd = poll_command(-1)).has_value()) {}
+        return *cmd;
+    }
+    virtual void prompt() const {}  // what to type, once per turn
 
     virtual void show() const = 0;
     virtual void refresh() = 0;
     virtual void winner_display(const Piece::Color&) = 0;
+    virtual void log_board() const {}  // board art to the debug log
+    // no win animation when nobody watches (EVE)
+    void set_animation(bool on) { animation_ = on; }
 
     virtual int count_left(const Piece&) const = 0;
     virtual int count_right(const Piece&) const = 0;
@@ -53,11 +64,46 @@ public:
     virtual bool is_valid_pos(int r, int c) const = 0;
     virtual bool is_full() const = 0;
 
+    // a SparseBoard has no grid worth scanning: ask it for the stones
+    // and the empty cells around them instead, size() is 0 if unbounded
+    virtual bool is_sparse() const { return false; }
+    virtual Position center() const { return {(int)size() / 2, (int)size() / 2}; }
+    // row-major, statuses as on the board
+    virtual std::vector<Piece> stones() const {
+        std::vector<Piece> ret;
+        for (int i = 0; i < (int)size(); i++) {
+            for (int j = 0; j < (int)size(); j++) {
+                if (size_t status = get_status(i, j)) { ret.emplace_back(i, j, static_cast<Color>(status)); }
+            }
+        }
+        return ret;
+    }
+    // empty cells within `radius` of a stone, row-major
+    std::vector<Position> candidates(int radius=2) const {
+        std::vector<Position> ret;
+        for (const Piece& p : stones()) {
+            for (int r = p.row - radius; r <= p.row + radius; r++) {
+                for (int c = p.col - radius; c <= p.col + radius; c++) {
+                    if (is_valid_pos(r, c) && get_status(r, c) == 0) { ret.emplace_back(r, c); }
+                }
+            }
+        }
+        auto less = [](const Position& a, const Position& b) {
+            return a.row != b.row ? a.row < b.row : a.col < b.col;
+        };
+        std::sort(ret.begin(), ret.end(), less);
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+
 protected:
     Piece last_piece_;
     bool status_;
+    bool animation_ = true;
 };  // endof class ChessBoard_base
 
+// BoardSize::Dynamic: the side is given to the constructor, len() reads it
+// from the object, the three fixed sizes have it as a constant
 template <BoardSize Size=BoardSize::Small>
 class ChessBoard : public ChessBoard_base {
 public:
@@ -65,15 +111,18 @@ public:
     using ArchiveSeq_type = std::string;
     using ArchiveTbl_type = std::vector<std::vector<size_t>>;
 
-    ChessBoard() 
-        : board_(size_, 
-            std::vector<std::shared_ptr<Position>>(
-                size_)) {
+    ChessBoard() : ChessBoard(size_) {}
+    explicit ChessBoard(size_t n)
+        : len_(n), board_(n, 
+            std::vector<std::shared_ptr<Piece>>(
+                n)) {
+        assert(Size == BoardSize::Dynamic ? is_valid_board_size(n) : n == size_);
         _init_board();
     }
     ChessBoard(const std::vector<std::vector<size_t>>& input_board, 
                const Piece& last_piece=invalid_piece) 
-        : board_(Size, std::vector<std::shared_ptr<Position>>(Size)) {
+        : len_(Size == BoardSize::Dynamic ? input_board.size() : size_),
+          board_(len_, std::vector<std::shared_ptr<Piece>>(len_)) {
         apply_board(input_board, last_piece);
     }
     ChessBoard(const ChessBoard& board) = default;
@@ -94,12 +143,12 @@ public:
             return ;
         }
         last_piece_ = Piece{piece.row, piece.col, 
-                            Piece::Color{piece.get_status() + 1}};
+                            static_cast<Piece::Color>(piece.get_status() + 1)};
 
         // has been move to rm_last_sp
         // board_[last_piece_.row][last_piece_.col] 
         //     = std::make_shared<Position>(Piece{last_piece_.row, last_piece_.col, 
-        //                                        Piece::Color{last_piece_.get_status() - 1}});
+        //                                        static_cast<Piece::Color>(last_piece_.get_status() - 1)});
         board_[piece.row][piece.col] 
             = std::make_shared<Piece>(last_piece_);
     }
@@ -132,8 +181,11 @@ public:
         return res;
     }
 
-    size_t len() const { return size(); }
-    size_t size() const override { return size_; }
+    size_t len() const {
+        if constexpr (Size == BoardSize::Dynamic) { return len_; }
+        else { return size_; }
+    }
+    size_t size() const override { return len(); }
 
     int count_left(const Piece& piece) const override {
         int row = piece.row;
@@ -313,12 +365,13 @@ protected:
     virtual void _init_board() {
         for (size_t i = 0; i < len(); i++) {
             for (size_t j = 0; j < len(); j++) {
-                board_[i][j] = std::make_shared<Position>(i, j);
+                board_[i][j] = std::make_shared<Piece>(i, j, Color::Invalid);
             }
         }
         last_piece_ = invalid_piece;
     } 
-    std::vector<std::vector<std::shared_ptr<Position>>> board_;
+    size_t len_;
+    std::vector<std::vector<std::shared_ptr<Piece>>> board_;
 private:
     /*
         if you specify a _last_piece, it will be the one,
@@ -329,20 +382,20 @@ private:
     Piece apply_board(const std::vector<std::vector<size_t>>& input_board, 
                       const Piece& last_piece=invalid_piece) {
         last_piece_ = last_piece;
-        for (size_t i = 0; i < size_; i++) {
-            for (size_t j = 0; j < size_; j++) {
+        for (size_t i = 0; i < len(); i++) {
+            for (size_t j = 0; j < len(); j++) {
                 switch (input_board[i][j]) {
                 case static_cast<size_t>(Color::Invalid) : {
-                    board_[i][j] = std::make_shared<Position>(i, j);
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::Invalid);
                 } break;
                 case static_cast<size_t>(Color::White) : {
-                    board_[i][j] = std::make_shared<Position>(Piece(i, j, Color::White));
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::White);
                 } break;
                 case static_cast<size_t>(Color::Black) : {
-                    board_[i][j] = std::make_shared<Position>(Piece(i, j, Color::Black));
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::Black);
                 } break;
                 case static_cast<size_t>(Color::BlackSp) : {
-                    board_[i][j] = std::make_shared<Position>(Piece(i, j, Color::BlackSp));
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::BlackSp);
                     if (last_piece_ == invalid_piece) {
                         last_piece_ = Piece{i, j, Color::BlackSp};
                     } else {
@@ -350,7 +403,7 @@ private:
                     }
                 } break;
                 case static_cast<size_t>(Color::WhiteSp) : {
-                    board_[i][j] = std::make_shared<Position>(Piece(i, j, Color::WhiteSp));
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::WhiteSp);
                     if (last_piece_ == invalid_piece) {
                         last_piece_ = Piece{i, j, Color::WhiteSp};
                     } else {
@@ -359,7 +412,7 @@ private:
                 } break;
                 default:
                     logwarn_invalid_pos(i, j);
-                    board_[i][j] = std::make_shared<Position>(i, j);
+                    board_[i][j] = std::make_shared<Piece>(i, j, Color::Invalid);
                 }
             }
         }
@@ -368,11 +421,13 @@ private:
         }
         return last_piece;
     }
-    static bool is_valid_row(int row) {  // i want them static  // ok :D  25.03.22
-        return row >= 0 and row < size_;
+protected:  // the screen boards check clicks and typed moves with them
+    // not static any more, a Dynamic board knows its side only at run time
+    bool is_valid_row(int row) const {  // i want them static  // ok :D  25.03.22
+        return row >= 0 and static_cast<size_t>(row) < len();
     }
-    static bool is_valid_col(int col) {
-        return col >= 0 and col < size_;
+    bool is_valid_col(int col) const {
+        return col >= 0 and static_cast<size_t>(col) < len();
     }
     bool is_valid_pos(int row, int col) const override {
         return is_valid_row(row) && is_valid_col(col);
@@ -403,7 +458,7 @@ public:
         this->rm_last_sp();
         this->update_new_piece(piece);
     }
-    Command get_command() override {
+    std::optional<Command> poll_command(int timeout_ms) override {
         // wait until being triggered
         // get from displayer
         //  这里我们有两种思路：
@@ -419,19 +474,18 @@ public:
             可能不是一样的，未来也可能有更多的不一样的需求，所以暂时先分出两个
             chessboard，先试试思路2，感觉很有趣   X-H 25.05.29
        */
-        Command ret = framework_.get_command();
-        if (this->board_[ret.pos.row][ret.pos.col]->get_status()) {
-            ret.pos.row = ret.pos.col = -1;  // occupied pos
-        }
+        std::optional<Command> cmd = framework_.get_command(timeout_ms);
+        if (!cmd.has_value()) { return std::nullopt; }  // no click in time
+        Command ret = *cmd;
         if (ret.type == CommandType::INVALID
             || (ret.type == CommandType::PIECE 
-                && ((ret.pos.row < 0 or ret.pos.col < 0)
-                    || (!this->is_valid_pos(ret.pos.row, ret.pos.col))
+                && (!this->is_valid_pos(ret.pos.row, ret.pos.col)
+                    || this->board_[ret.pos.row][ret.pos.col]->get_status()  // occupied pos
                    )
                )
            ) {
             std::cout << HELPER_INVALID_POSITION << "\n";
-            ret = this->get_command();
+            return std::nullopt;
         }
         return ret;
     }
@@ -462,7 +516,7 @@ private:
     void rm_last_sp() {
         if (this->last_piece_.get_status() == 0) { return ; }  // empty last_piece
         framework_.remove_last_sp(this->last_piece_);
-        this->last_piece_.color = Piece::Color{this->last_piece_.get_status() - 1};
+        this->last_piece_.color = static_cast<Piece::Color>(this->last_piece_.get_status() - 1);
         // LOL, you update this last_piece_ that is going to be reset here
         // and forget to update the board_ XD XQX 25.03.24
         this->board_[this->last_piece_.row][this->last_piece_.col]
@@ -479,6 +533,9 @@ private:
     void show_board_without_log() const {
         framework_.show_without_log();
     }
+    void log_board() const override {
+        framework_.log_board();
+    }
 
     GuiDisplayer<Size> framework_;
 };  // endof class GuiBoard
@@ -507,26 +564,37 @@ public:
         update_new_piece(piece);
     }
 
-    Command get_command() override {
-        std::string input_str;
+    void prompt() const override {
         std::cout << HELPER_RETURN2MENU << "\n";
         std::cout << HELPER_PLACE_PIECE << "\n";
-        std::cin >> input_str;
-        Command ret = CmdBoard::validate_input(input_str);
+    }
+    std::optional<Command> poll_command(int timeout_ms) override {
+        std::optional<std::string> input_str = InputPoller::get().next_word(timeout_ms);
+        if (!input_str.has_value()) {
+            if (InputPoller::get().eof()) {  // stdin is gone, nobody to play with
+                return Command{CommandType::QUIT, {}};
+            }
+            return std::nullopt;
+        }
+        Command ret = CmdBoard::validate_input(*input_str);
         if (ret.type == CommandType::INVALID
             || (ret.type == CommandType::PIECE 
-                && (ret.pos.row < 0 or ret.pos.col < 0))) {
+                && (!this->is_valid_pos(ret.pos.row, ret.pos.col)
+                    || this->board_[ret.pos.row][ret.pos.col]->get_status()  // occupied pos
+                   )
+               )
+           ) {
             std::cout << HELPER_INVALID_POSITION << "\n";
-            ret = this->get_command();
+            prompt();
+            return std::nullopt;
         }
         return ret;
     }
+    // CmdDisplayer clears the screen itself, and only on a full redraw
     void show() const override {
-        cmd_clear();
         show_board();
     }
     void show_without_log() const {
-        cmd_clear();
         show_board_without_log();
     }
     void refresh() override {
@@ -552,7 +620,7 @@ private:
         ss << std::string(str.size(), piece_char) << "\n"; 
         ss << str << "\n";
         ss << std::string(str.size(), piece_char) << "\n";
-        log_info(str.c_str());
+        log_at(BOARD, INFO, str.c_str());
         return ss.str();
     }
     void winner_display(const Piece::Color&) override {
@@ -566,80 +634,54 @@ private:
         std::cout << "\n";
     }
     void show_pieces_in_a_row() {
-        count_res_8 res;
-        this->count_dir(this->last_piece_, &res);
-        bool is_not_over = false;
-        for (int i = 0; i < 10; i++) {
-            if (res.left + res.right >= NoPtW - 1) {
-                display_left_right(this->last_piece_, res.left, res.right);
-            } else if (res.up + res.down >= NoPtW - 1) {
-                display_up_down(this->last_piece_, res.up, res.down);
-            } else if (res.up_left + res.down_right >= NoPtW - 1) {
-                display_up_left_down_right(
-                    this->last_piece_, res.up_left, res.down_right
-                );
-            } else if (res.down_left + res.up_right >= NoPtW - 1) {
-                display_down_left_up_right(
-                    this->last_piece_, res.down_left, res.up_right
-                );
-            } else {
-                is_not_over = true;
-            }  
-            usleep(200000);
-        }
-        if (is_not_over) {
+        std::vector<std::vector<Position>> frames = win_frames();
+        if (frames.empty()) {
             log_error("game is not over yet");
         }
-        this->show();
-    }
-    static constexpr int usec = 100000;
-    void display_left_right(const Piece& piece, int left, int right) {
-        int row = piece.row, col = piece.col;
-        while (left > 0 or right > 0) {
-            if (left > 0) { framework_.set_highlight(row, col - left); }
-            if (right > 0) { framework_.set_highlight(row, col + right); }
-            left--; right--;
-            this->show_without_log();
-            usleep(usec);
-        }
-        framework_.set_highlight(row, col);
-        this->show_without_log();
-    }
-    void display_up_down(const Piece& piece, int up, int down) {
-        int row = piece.row, col = piece.col;
-        while (up > 0 or down > 0) {
-            if (up > 0) { framework_.set_highlight(row - up, col); }
-            if (down > 0) { framework_.set_highlight(row + down, col); }
-            up--; down--;
-            this->show_without_log();
-            usleep(usec);
+        size_t i = 0;
+        if (this->animation_ && isatty(STDOUT_FILENO)) {
+            FrameScheduler scheduler(win_animation_fps);
+            while (i < frames.size()) {
+                for (const Position& p : frames[i++]) {
+                    framework_.set_highlight(p.row, p.col);
+                }
+                this->show_without_log();
+                if (i < frames.size() && scheduler.wait_next_frame()) { break; }  // skipped
+            }
         }
-        framework_.set_highlight(row, col);
-        this->show_without_log();
-    }
-    void display_up_left_down_right(const Piece& piece, int up_left, int down_right) {
-        int row = piece.row, col = piece.col;
-        while (up_left > 0 or down_right > 0) {
-            if (up_left > 0) { framework_.set_highlight(row - up_left, col - up_left); }
-            if (down_right > 0) { framework_.set_highlight(row + down_right, col + down_right); }
-            up_left--; down_right--;
-            this->show_without_log();
-            usleep(usec);
+        for (; i < frames.size(); i++) {  // the rest at once
+            for (const Position& p : frames[i]) {
+                framework_.set_highlight(p.row, p.col);
+            }
         }
-        framework_.set_highlight(row, col);
-        this->show_without_log();
-    }
-    void display_down_left_up_right(const Piece& piece, int down_left, int up_right) {
-        int row = piece.row, col = piece.col;
-        while (down_left > 0 or up_right > 0) {
-            if (down_left > 0) { framework_.set_highlight(row + down_left, col - down_left); }
-            if (up_right > 0) { framework_.set_highlight(row - up_right, col + up_right); }
-            down_left--; up_right--;
-            this->show_without_log();
-            usleep(usec);
+        this->show();
+    }
+    static constexpr size_t win_animation_fps = 10;
+    // the five (or more) in a row lights up from both ends towards the last piece,
+    // every frame keeps what the previous ones lit
+    std::vector<std::vector<Position>> win_frames() const {
+        count_res_8 res;
+        this->count_dir(this->last_piece_, &res);
+        // pieces counted each way, and which way is which
+        const std::array<std::tuple<int, int, int, int>, 4> lines = {{
+            {res.left, res.right, 0, 1},
+            {res.up, res.down, 1, 0},
+            {res.up_left, res.down_right, 1, 1},
+            {res.up_right, res.down_left, 1, -1}
+        }};
+        std::vector<std::vector<Position>> frames;
+        const int row = this->last_piece_.row, col = this->last_piece_.col;
+        for (auto [back, forth, inc_r, inc_c] : lines) {
+            if (back + forth < NoPtW - 1) { continue; }
+            for (; back > 0 or forth > 0; back--, forth--) {
+                frames.emplace_back();
+                if (back > 0) { frames.back().emplace_back(row - back * inc_r, col - back * inc_c); }
+                if (forth > 0) { frames.back().emplace_back(row + forth * inc_r, col + forth * inc_c); }
+            }
+            frames.push_back({Position{row, col}});
+            break;
         }
-        framework_.set_highlight(row, col);
-        this->show_without_log();
+        return frames;
     }
 
     void _init_board() override {
@@ -649,7 +691,7 @@ private:
     void rm_last_sp() {
         if (this->last_piece_.get_status() == 0) { return ; }  // empty last_piece
         framework_.remove_last_sp(this->last_piece_);
-        this->last_piece_.color = Piece::Color{this->last_piece_.get_status() - 1};
+        this->last_piece_.color = static_cast<Piece::Color>(this->last_piece_.get_status() - 1);
         // LOL, you update this last_piece_ that is going to be reset here
         // and forget to update the board_ XD XQX 25.03.24
         this->board_[this->last_piece_.row][this->last_piece_.col]
@@ -682,7 +724,7 @@ private:
 
         if (str.size() != 2) return Command{CommandType::INVALID, {}};
         auto ret = Command{CommandType::PIECE, {get_int(str[0]), get_int(str[1])}};
-        if (ret.pos.row == -1 or ret.pos.col == -1) return ret;
+        if (!this->is_valid_pos(ret.pos.row, ret.pos.col)) return ret;  // 'z' on a 13 board too
         if (this->board_[ret.pos.row][ret.pos.col]->get_status()) {
             ret.pos.row = ret.pos.col = -1;  // occupied pos
             std::cout << HELPER_OCCUPIED_POSITION << "\n";
@@ -712,11 +754,60 @@ private:
     void show_board_without_log() const {
         framework_.show_without_log();
     }
+    void log_board() const override {
+        framework_.log_board();
+    }
     
     CmdDisplayer<Size> framework_;
     // TODO: we can set Displayer ptr here and alloc a CmdDisplayer in constructor 2025.5.6
 };  // endof class CmdBoard
 
+// no display and no input, for robot-only games (match harness)
+template <BoardSize Size=BoardSize::Small>
+class HeadlessBoard : public ChessBoard<Size> {
+public:
+    static constexpr size_t size_ = static_cast<size_t>(Size);
+    using ArchiveSeq_type = typename ChessBoard<Size>::ArchiveSeq_type;
+    using ArchiveTbl_type = typename ChessBoard<Size>::ArchiveTbl_type;
+
+    HeadlessBoard() : ChessBoard<Size>() {}
+    explicit HeadlessBoard(size_t n) : ChessBoard<Size>(n) {}
+
+    void update(const Piece& piece) override {
+        rm_last_sp();
+        ChessBoard<Size>::update(piece);
+    }
+    std::optional<Command> poll_command(int) override {
+        return Command{CommandType::QUIT, {}};  // nobody to ask
+    }
+    void show() const override {}
+    void refresh() override {}
+    void winner_display(const Piece::Color&) override {}
+
+private:
+    void show_board() const override {}
+    void rm_last_sp() {
+        if (this->last_piece_.get_status() == 0) { return ; }  // empty last_piece
+        this->last_piece_.color = static_cast<Piece::Color>(this->last_piece_.get_status() - 1);
+        this->board_[this->last_piece_.row][this->last_piece_.col]
+            = std::make_shared<Piece>(this->last_piece_);
+    }
+};  // endof class HeadlessBoard
+
+// a board for robot-only play at any engine size: the three fixed sizes
+// get their own instantiation, the rest share the Dynamic one
+// nullptr if the size is out of [min_board_size, max_board_size]
+inline std::shared_ptr<ChessBoard_base> make_headless_board(size_t size) {
+    switch (size) {
+    case static_cast<size_t>(BoardSize::Small) : return std::make_shared<HeadlessBoard<BoardSize::Small>>();
+    case static_cast<size_t>(BoardSize::Middle) : return std::make_shared<HeadlessBoard<BoardSize::Middle>>();
+    case static_cast<size_t>(BoardSize::Large) : return std::make_shared<HeadlessBoard<BoardSize::Large>>();
+    default:
+        if (!is_valid_board_size(size)) { return nullptr; }
+        return std::make_shared<HeadlessBoard<BoardSize::Dynamic>>(size);
+    }
+}
+
 }  // endof namespace mfwu
 
 #endif  // __CHESSBOARD_HPP__
\ No newline at end of file
@@ -0,0 +1,160 @@
+#ifndef __DATASET_HPP__
+#define __DATASET_HPP__
+
+#include "common.hpp"
+#include "ArchiveReader.hpp"
+#include "BoardHash.hpp"
+
+namespace mfwu {
+
+/*
+    columnar position dataset, little endian
+
+    file header (16 bytes):
+        char[4] "GBDS", u16 version, u16 board size,
+        u16 flags (bit0: deduplicated), u16 reserved, u32 reserved
+    then chunks, each one:
+        char[4] "CHNK", u32 rows, u32 bytes per board, u32 reserved
+        boards : rows * bytes per board, 2 bits per cell, 4 cells per byte
+                 (low bits first), 0 empty, 1 white, 2 black
+        stm    : rows * u8,  side to move, 1 white, 2 black
+        move   : rows * u16, row * size + col of the move played
+        result : rows * i8,  +1 side to move wins, -1 loses, 0 draw
+        ply    : rows * u16, number of pieces on the board
+    a reader can mmap a chunk and take each column as a plain array
+*/
+class Dataset {
+public:
+    static constexpr const char file_magic[4]  = {'G', 'B', 'D', 'S'};
+    static constexpr const char chunk_magic[4] = {'C', 'H', 'N', 'K'};
+    static constexpr uint16_t version = 1;
+    static constexpr uint16_t flag_dedup = 1;
+
+    static uint8_t cell_code(size_t status) {
+        return status == 0 ? 0 :
+               Piece::get_real_status(status) == static_cast<size_t>(Piece::Color::White) ? 1 : 2;
+    }
+    static size_t bytes_per_board(size_t size) {
+        return (size * size + 3) / 4;
+    }
+};  // endof class Dataset
+
+class DatasetWriter {
+public:
+    static constexpr size_t default_chunk_rows = 1UL << 16;
+
+    DatasetWriter(const std::string& filename, size_t size,
+                  bool dedup=false, size_t chunk_rows=default_chunk_rows)
+        : size_(size), board_bytes_(Dataset::bytes_per_board(size)),
+          dedup_(dedup), chunk_rows_(std::max<size_t>(chunk_rows, 1)),
+          ofs_(filename, std::ios::out | std::ios::binary | std::ios::trunc) {
+        if (!ofs_.is_open()) {
+            std::cerr << "dataset: cannot open " << filename << "\n";
+            return ;
+        }
+        ofs_.write(Dataset::file_magic, 4);
+        put<uint16_t>(Dataset::version);
+        put<uint16_t>(static_cast<uint16_t>(size_));
+        put<uint16_t>(dedup_ ? Dataset::flag_dedup : 0);
+        put<uint16_t>(0);
+        put<uint32_t>(0);
+        reserve_chunk();
+    }
+    ~DatasetWriter() {
+        close();
+    }
+
+    // every position of a finished game, abandoned games are skipped
+    void append(const ArchiveGame& game) {
+        if (game.size != size_) { skipped_games_++; return ; }
+        std::optional<Piece::Color> res = game.result();
+        if (!res.has_value()) { skipped_games_++; return ; }
+        std::vector<uint8_t> board(size_ * size_, 0);  // real statuses
+        for (size_t ply = 0; ply < game.moves.size(); ply++) {
+            PackedMove mv = game.moves[ply];
+            if (!dedup_ || seen_.insert(BoardHash::canonical_hash(board, size_)).second) {
+                int8_t result = 0;
+                if (*res != Piece::Color::Invalid) {
+                    result = Piece::is_same_color(*res, mv.color()) ? 1 : -1;
+                }
+                append_row(board, mv, result, ply);
+            } else {
+                dup_rows_++;
+            }
+            board[mv.row() * size_ + mv.col()] = mv.get_real_status();
+        }
+        games_++;
+    }
+    void close() {
+        if (!ofs_.is_open()) { return ; }
+        flush_chunk();
+        ofs_.close();
+    }
+
+    size_t get_rows() const { return rows_; }
+    size_t get_games() const { return games_; }
+    size_t get_skipped_games() const { return skipped_games_; }
+    size_t get_dup_rows() const { return dup_rows_; }
+
+private:
+    void append_row(const std::vector<uint8_t>& board, PackedMove mv, int8_t result, size_t ply) {
+        size_t off = boards_.size();
+        boards_.resize(off + board_bytes_, 0);
+        for (size_t i = 0; i < board.size(); i++) {
+            boards_[off + i / 4] |= Dataset::cell_code(board[i]) << (2 * (i % 4));
+        }
+        stm_.push_back(Dataset::cell_code(mv.get_real_status()));
+        move_.push_back(static_cast<uint16_t>(mv.row() * size_ + mv.col()));
+        result_.push_back(result);
+        ply_.push_back(static_cast<uint16_t>(ply));
+        rows_++;
+        if (stm_.size() >= chunk_rows_) { flush_chunk(); }
+    }
+    void flush_chunk() {
+        if (stm_.empty()) { return ; }
+        ofs_.write(Dataset::chunk_magic, 4);
+        put<uint32_t>(static_cast<uint32_t>(stm_.size()));
+        put<uint32_t>(static_cast<uint32_t>(board_bytes_));
+        put<uint32_t>(0);
+        write_column(boards_);
+        write_column(stm_);
+        write_column(move_);
+        write_column(result_);
+        write_column(ply_);
+        boards_.clear(); stm_.clear(); move_.clear(); result_.clear(); ply_.clear();
+    }
+    void reserve_chunk() {
+        boards_.reserve(chunk_rows_ * board_bytes_);
+        stm_.reserve(chunk_rows_);
+        move_.reserve(chunk_rows_);
+        result_.reserve(chunk_rows_);
+        ply_.reserve(chunk_rows_);
+    }
+    template <typename T>
+    void write_column(const std::vector<T>& col) {
+        ofs_.write(reinterpret_cast<const char*>(col.data()), col.size() * sizeof(T));
+    }
+    template <typename T>
+    void put(T val) {  // we only run on little endian boxes
+        ofs_.write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    size_t size_;
+    size_t board_bytes_;
+    bool dedup_;
+    size_t chunk_rows_;
+    std::ofstream ofs_;
+
+    std::vector<uint8_t>  boards_;
+    std::vector<uint8_t>  stm_;
+    std::vector<uint16_t> move_;
+    std::vector<int8_t>   result_;
+    std::vector<uint16_t> ply_;
+
+    std::unordered_set<uint64_t> seen_;
+    size_t rows_ = 0, games_ = 0, skipped_games_ = 0, dup_rows_ = 0;
+};  // endof class DatasetWriter
+
+}  // endof namespace mfwu
+
+#endif  // __DATASET_HPP__
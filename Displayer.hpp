@@ -4,6 +4,9 @@
 #include "common.hpp"
 #include "Logger.hpp"
 #include "gui_common.hpp"
+#include "BoardCodec.hpp"
+#include <unistd.h>
+#include <sys/ioctl.h>
 
 // gui(?) of cmd mode lol
 namespace mfwu {
@@ -31,6 +34,36 @@ public:
 
     virtual const std::vector<std::string>& get_framework() const = 0;
     virtual void unzip_tbl(const std::string_view& str, bool mode) = 0;
+    virtual bool unpack_tbl(const std::string_view& str) = 0;  // BoardCodec
+
+    // "0000111" -> "0{3}1{2}"
+    static std::string zip_rle(const std::vector<std::vector<size_t>>& board) {
+        std::string ret;
+        size_t last_status = -1;
+        size_t more_num = 0;
+        for (const auto& line : board) {
+            for (const size_t& status : line) {
+                if (status == last_status) {
+                    more_num++;
+                } else {  // different status
+                    if (more_num) {
+                        ret += '{';
+                        ret += std::to_string(more_num);  // status < 10 is better
+                        ret += '}';
+                        more_num = 0;
+                    }
+                    last_status = status;
+                    ret += '0' + status;
+                }
+            }
+        }
+        if (more_num) {
+            ret += '{';
+            ret += std::to_string(more_num);
+            ret += '}';
+        }
+        return ret;
+    }
 };  // endof class Displayer_base_base
 
 #define DEFINE_SHAPES \
@@ -46,6 +79,39 @@ static constexpr const char outer_border_char = base_type::outer_border_char;\
 static constexpr const char highlight_left_char = base_type::highlight_left_char;\
 static constexpr const char highlight_right_char = base_type::highlight_right_char;
 
+// fixed-rate frames for cmd animations, waits on stdin instead of sleeping
+// so a key press cuts the animation short
+class FrameScheduler {
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    FrameScheduler(size_t fps) 
+        : period_(std::chrono::microseconds(1000000 / std::max<size_t>(fps, 1))),
+          next_(clock_type::now() + period_) {}
+
+    // blocks until the next frame is due, a late frame does not pile up
+    // true if input came first, the line typed is eaten
+    bool wait_next_frame() {
+        while (true) {
+            auto now = clock_type::now();
+            if (now >= next_) {
+                next_ = std::max(next_ + period_, now);
+                return false;
+            }
+            int ms = std::chrono::ceil<std::chrono::milliseconds>(next_ - now).count();
+            // a key, or a closed stdin: nobody is watching either way
+            if (InputPoller::get().wait_readable(ms)) {
+                InputPoller::get().discard();
+                return true;
+            }
+        }
+    }
+
+private:
+    clock_type::duration period_;
+    clock_type::time_point next_;
+};  // endof class FrameScheduler
+
 template <BoardSize Size=BoardSize::Small, bool Mode=true>
 class Displayer_base : public Displayer_base_base {
     /*  
@@ -63,23 +129,34 @@ class Displayer_base : public Displayer_base_base {
         [i, j] -> [2 + 1 * i, 4 + 2 * j]
     */
 public:
+    // 0 for BoardSize::Dynamic, the side is known at run time only: len()
     static constexpr size_t size_   = static_cast<size_t>(Size);
     static constexpr size_t height_ = 1 * (3 * Mode + size_);
     static constexpr size_t width_  = (1 + Mode) * (3 * Mode + size_);
     using base_type = Displayer_base_base;
     DEFINE_SHAPES;
 
-    Displayer_base() : framework_(height_, std::string(width_, inner_border_char)) {
+    Displayer_base() : Displayer_base(size_) {}
+    explicit Displayer_base(size_t n) 
+        : len_(n), framework_(height(), std::string(width(), inner_border_char)) {
         _init_framework();
         load_empty_board();
     }
     // Displayer_base(const std::vector<std::vector<std::shared_ptr<Position>>>& board_) 
     Displayer_base(const std::vector<std::vector<size_t>>& board_) 
-        : framework_(height_, std::string(width_, inner_border_char)) {
+        : len_(Size == BoardSize::Dynamic ? board_.size() : size_),
+          framework_(height(), std::string(width(), inner_border_char)) {
         _init_framework();
         reconstruct(board_);
     } 
 
+    size_t len() const {
+        if constexpr (Size == BoardSize::Dynamic) { return len_; }
+        else { return size_; }
+    }
+    size_t height() const { return 1 * (3 * Mode + len()); }
+    size_t width() const { return (1 + Mode) * (3 * Mode + len()); }
+
     const std::vector<std::string>& get_framework() const override {
         return framework_;
     };
@@ -124,8 +201,8 @@ public:
     }
 
     virtual void load_empty_board() {
-        for (int i = 0; i < size_; i++) {
-            for (int j = 0; j < size_; j++) {
+        for (size_t i = 0; i < len(); i++) {
+            for (size_t j = 0; j < len(); j++) {
                 print_empty_position(i, j);
             }
         }
@@ -161,40 +238,47 @@ protected:
             print_unknown_status_piece(i, j);
         }
     }
+    size_t len_;
     std::vector<std::string> framework_;
 
 private:
+    // A..Z, a..z past 26 (the run-time sides, logE only), blank past 52:
+    // nothing that could pass for a bracket or a stone
+    static char axis_label(size_t i) {
+        return i < 26 ? static_cast<char>('A' + i)
+             : i < 52 ? static_cast<char>('a' + (i - 26)) : ' ';
+    }
     void _init_framework() {
         if (Mode) {
-            for (int j = 0; j < size_; j++) {
-                framework_[0][get_col_in_framework(j)] = 'A' + j;
+            for (size_t j = 0; j < len(); j++) {
+                framework_[0][get_col_in_framework(j)] = axis_label(j);
             }
-            for (int i = 0; i < size_; i++) {
-                framework_[get_row_in_framework(i)][0] = 'A' + i;
+            for (size_t i = 0; i < len(); i++) {
+                framework_[get_row_in_framework(i)][0] = axis_label(i);
             }
-            for (int j = 0; j <= size_; j++) {
+            for (size_t j = 0; j <= len(); j++) {
                 // framework_[get_row_in_framework(-1)][get_col_in_framework(j)] = outer_border_char;
                 get_pos_ref_in_framework(-1, j) = outer_border_char;
             }
-            for (int j = 0; j <= size_; j++) {
-                // framework_[get_row_in_framework(size_)][get_col_in_framework(j)] = outer_border_char;
-                get_pos_ref_in_framework((int)size_, j) = outer_border_char;
+            for (size_t j = 0; j <= len(); j++) {
+                // framework_[get_row_in_framework(len())][get_col_in_framework(j)] = outer_border_char;
+                get_pos_ref_in_framework((int)len(), j) = outer_border_char;
             }
-            for (int i = 0; i <= size_; i++) {
+            for (size_t i = 0; i <= len(); i++) {
                 // framework_[get_row_in_framework(i)][get_col_in_framework(-1)] = outer_border_char;
                 get_pos_ref_in_framework(i, -1) = outer_border_char;
             }
-            for (int i = 0; i <= size_; i++) {
-                // framework_[get_row_in_framework(i)][get_col_in_framework(size_)] = outer_border_char;
-                get_pos_ref_in_framework(i, (int)size_) = outer_border_char;
+            for (size_t i = 0; i <= len(); i++) {
+                // framework_[get_row_in_framework(i)][get_col_in_framework(len())] = outer_border_char;
+                get_pos_ref_in_framework(i, (int)len()) = outer_border_char;
             }
             // framework_[get_row_in_framework(-1)][get_col_in_framework(-1)] = outer_border_char;
             get_pos_ref_in_framework(-1, -1) = outer_border_char;
         }
     }
     void reconstruct(const std::vector<std::vector<size_t>>& board_) {
-        for (int i = 0; i < size_; i++) {
-            for (int j = 0; j < size_; j++) {
+        for (size_t i = 0; i < len(); i++) {
+            for (size_t j = 0; j < len(); j++) {
                 update_directly(i, j, board_[i][j]);
             }
         }
@@ -214,18 +298,25 @@ public:
 
     DEFINE_SHAPES; DEFINE_SIZES;
 
-    Displayer() : base_type() {}
-    Displayer(const std::vector<std::vector<size_t>>& board_) : base_type(board_) {} 
+    Displayer() : base_type(), highlighted_(size_ * size_, false) {}
+    explicit Displayer(size_t n) : base_type(n), highlighted_(n * n, false) {}
+    Displayer(const std::vector<std::vector<size_t>>& board_) 
+        : base_type(board_), highlighted_(this->len() * this->len(), false) {} 
 
+    // rendering only, what gets logged is up to BOARD_LOG_MODE (see log_board)
     virtual void show() const {
         std::stringstream ss;
-        log_debug("Board: ");
         for (const std::string& line : this->framework_) {
             ss << line << "\n";
-            log_debug(XQ4GB_TIMESTAMP, line.c_str());
         }
         std::cout << ss.str();
     }
+    void log_board() const {
+        log_at(BOARD, DEBUG, "Board: ");
+        for (const std::string& line : this->framework_) {
+            log_at(BOARD, DEBUG, XQ4GB_TIMESTAMP, line.c_str());
+        }
+    }
     virtual void remove_last_sp(const Piece& last_piece) {  // no override ?
         remove_highlight(last_piece.row, last_piece.col);
         remove_sp(last_piece.row, last_piece.col);
@@ -245,8 +336,17 @@ public:
 
         remove_highlight();
         if (status) { add_highlight(i, j); }
-        // there's efficient approach, but i'm lazy enough...
-        // TODO
+    }
+    // many cells at once, one highlight pass at the end:
+    // the last piece placed is the one highlighted, as if updated one by one
+    void update(const std::vector<Piece>& cells) {
+        const Piece* last = nullptr;
+        for (const Piece& p : cells) {
+            base_type::update_directly(p.row, p.col, p.get_status());
+            if (p.get_status()) { last = &p; }
+        }
+        remove_highlight();
+        if (last) { add_highlight(last->row, last->col); }
     }
 
     std::string zip_tbl(const std::vector<std::vector<size_t>>& board) const {
@@ -261,30 +361,7 @@ public:
             }
         } else {  // zip_mode_ = true
             ret += "* ";
-            size_t last_status = -1;
-            size_t more_num = 0;
-            for (const auto& line : board) {
-                for (const size_t& status : line) {
-                    if (status == last_status) {
-                        more_num++;
-                    } else {  // different status
-                        if (more_num) {
-                            ret += '{';
-                            ret += std::to_string(more_num);  // status < 10 is better
-                            ret += '}';
-                            more_num = 0;
-                        }
-                        last_status = status;
-                        ret += '0' + status;
-                    }
-                }
-            }
-            if (more_num) {
-                ret += '{';
-                ret += std::to_string(more_num);
-                ret += '}';
-                more_num = 0;
-            }
+            ret += base_type::zip_rle(board);
             if (ret.size() > status_num / 2) {
                 zip_mode_ = false;
             }
@@ -296,76 +373,82 @@ public:
     void unzip_tbl(const std::string_view& str, bool mode) override {
         // ensure you have initialized it first
         int i = 0, j = 0;
+        // rows come from len(), height_ is only the static guess (3 for Dynamic)
+        auto full = [&]() { return static_cast<size_t>(i) >= this->len(); };
         if (mode == false) {
-            for (int k = 0; k < str.size(); k++) {
+            for (size_t k = 0; k < str.size() && !full(); k++) {
                 base_type::update_directly(i, j, str[k] - '0');
                 advance(i, j);
-                if (i >= height_) break;
             }
         } else {
             int last_num = -1;
-            for (int k = 0; k < str.size(); k++) {
+            for (size_t k = 0; k < str.size() && !full(); k++) {
                 if (str[k] == '{') {
-                    int kc = k;
-                    while (str[k] != '}') {  // once i wrote like this : k != '}' : k++ holy s🐻🐻t
+                    size_t kc = k;
+                    while (k < str.size() && str[k] != '}') {  // once i wrote like this : k != '}' : k++ holy s🐻🐻t
                         k++;
                     }
-                    kc = atoi(str.substr(kc + 1, k - kc - 1).data());
-                    for (int ii = 0; ii < kc; ii++) {
+                    if (k == str.size()) break;  // cut off line, no '}'
+                    int cnt = atoi(std::string(str.substr(kc + 1, k - kc - 1)).c_str());
+                    for (int ii = 0; ii < cnt && !full(); ii++) {
                         base_type::update_directly(i, j, last_num);
-                        advance(i, j); if (i >= height_) break;
+                        advance(i, j);
                     }
                 } else if (is_digit(str[k])) {
                     last_num = str[k] - '0';
                     base_type::update_directly(i, j, last_num);
-                    advance(i, j); if (i >= height_) break;
+                    advance(i, j);
                 }
             }
         }
     }
 
+    // false if it's broken or for another board size, nothing is touched then
+    bool unpack_tbl(const std::string_view& str) override {
+        size_t n = 0;
+        if (!BoardCodec::decode(str, unpacked_, n) || n != this->len()) { return false; }
+        for (size_t k = 0; k < n * n; k++) {
+            base_type::update_directly(k / n, k % n, unpacked_[k]);
+        }
+        return true;
+    }
+
     void load_empty_board() override {
         base_type::load_empty_board();
         this->remove_highlight();
     }
 
 protected:
+    // only the cells we highlighted are touched, no framework scan
     virtual void remove_highlight() {
-        for (std::string& line : this->framework_) {
-            for (char& c : line) {
-                if (c == highlight_left_char 
-                    or c == highlight_right_char) {
-                    c = inner_border_char;
-                }
-            }
+        for (auto [r, c] : highlights_) {
+            clear_brackets(r, c);
+            highlighted_[r * this->len() + c] = false;
         }
+        highlights_.clear();
     }
     virtual void remove_highlight(int r, int c) {
-        auto [row, col] = base_type::get_pos_in_framework(r, c);
-        char* ch = &this->framework_[row][col - 1];
-        if (*ch == highlight_left_char) {
-            *ch = inner_border_char;
-        }
-        ch = &this->framework_[row][col + 1];
-        if (*ch == highlight_right_char) {
-            *ch = inner_border_char;
+        clear_brackets(r, c);
+        if (highlighted_[r * this->len() + c]) {
+            highlighted_[r * this->len() + c] = false;
+            auto it = std::find(highlights_.begin(), highlights_.end(), std::make_pair(r, c));
+            *it = highlights_.back();
+            highlights_.pop_back();
         }
+        // [c-1]'s ']' is [c]'s '[' and so on, give the neighbours theirs back
+        if (c > 0 && highlighted_[r * this->len() + c - 1]) { draw_brackets(r, c - 1); }
+        if (c + 1 < (int)this->len() && highlighted_[r * this->len() + c + 1]) { draw_brackets(r, c + 1); }
     }
     virtual void add_highlight(const Piece& last_piece) {
-        auto [row, col] = base_type::get_pos_in_framework(last_piece.row, 
-                                               last_piece.col);
-        // framework_[row - 1][col] = highlight_up_down_char;
-        // framework_[row + 1][col] = highlight_up_down_char;
-        this->framework_[row][col - 1] = highlight_left_char;
-        this->framework_[row][col + 1] = highlight_right_char;
+        add_highlight(last_piece.row, last_piece.col);
     }
     virtual void add_highlight(int r, int c) {
         // assert(...)
-        auto [row, col] = base_type::get_pos_in_framework(r, c);
-        // framework_[row - 1][col] = highlight_up_down_char;
-        // framework_[row + 1][col] = highlight_up_down_char;
-        this->framework_[row][col - 1] = highlight_left_char;
-        this->framework_[row][col + 1] = highlight_right_char;
+        draw_brackets(r, c);
+        if (!highlighted_[r * this->len() + c]) {
+            highlighted_[r * this->len() + c] = true;
+            highlights_.emplace_back(r, c);
+        }
     }
     virtual void remove_sp() {
         for (auto line : this->framework_) {
@@ -401,21 +484,42 @@ protected:
                 log_error("last piece is not placed yet");
             } else {
                 add_sp(Piece{last_piece.row, last_piece.col, 
-                       Piece::Color{Piece::get_real_status(last_piece.color) + 1}});  // CHECK: can i?
+                       static_cast<Piece::Color>(Piece::get_real_status(last_piece.color) + 1)});  // CHECK: can i?
             }
         }
     }
 
 private:
     void advance(int& i, int& j) {
-        if (j < size_ - 1) {
+        if (static_cast<size_t>(j) + 1 < this->len()) {
             j++;
         } else {
             i++; j = 0;
         }
     }
+    void draw_brackets(int r, int c) {
+        auto [row, col] = base_type::get_pos_in_framework(r, c);
+        // framework_[row - 1][col] = highlight_up_down_char;
+        // framework_[row + 1][col] = highlight_up_down_char;
+        this->framework_[row][col - 1] = highlight_left_char;
+        this->framework_[row][col + 1] = highlight_right_char;
+    }
+    void clear_brackets(int r, int c) {
+        auto [row, col] = base_type::get_pos_in_framework(r, c);
+        char* ch = &this->framework_[row][col - 1];
+        if (*ch == highlight_left_char) {
+            *ch = inner_border_char;
+        }
+        ch = &this->framework_[row][col + 1];
+        if (*ch == highlight_right_char) {
+            *ch = inner_border_char;
+        }
+    }
 
     mutable bool zip_mode_ = true;  // 0 : "0000111", 1 : "0{3}1{2}"
+    std::vector<uint8_t> unpacked_;  // reused by unpack_tbl
+    std::vector<std::pair<int, int>> highlights_;  // a handful at most
+    std::vector<bool> highlighted_;                // len() * len() flags
 };  // endof class Displayer
 
 template <BoardSize Size=BoardSize::Small>
@@ -428,16 +532,90 @@ public:
     CmdDisplayer() : base_type() {}
     CmdDisplayer(const std::vector<std::vector<size_t>>& board_) : base_type(board_) {}
 
+    void show() const override {
+        render();
+    }
     void show_without_log() const {
-        std::stringstream ss;
-        for (const std::string& line : this->framework_) {
-            ss << line << "\n";
-        }
-        std::cout << ss.str();
+        render();
     }
     void set_highlight(int r, int c) {
         base_type::add_highlight(r, c);
     }
+    // the screen was touched by someone else, draw everything next time
+    void invalidate() const {
+        drawn_.clear();
+    }
+
+private:
+    // lines the prompts below the board may take, the board must not scroll
+    static constexpr size_t prompt_rows = 8;
+    // unchanged chars cheaper to resend than a new cursor move
+    static constexpr size_t max_gap = 6;
+
+    /*
+        the board sits at the top left corner of the screen (CMD_CLEAR homes the cursor),
+        so framework_[r][c] is at row r + 1, col c + 1, and only the runs that differ
+        from the last frame are sent, e.g. "\033[5;9H*]" for a new piece.
+        the cursor is parked below the board and whatever was printed there
+        (prompts, echoed input, the winner banner) is erased
+    */
+    void render() const {
+        std::string out;
+        if (drawn_.empty() || !can_diff()) {
+            out.reserve(strlen(CMD_CLEAR) + height_ * (width_ + 1));
+            out += CMD_CLEAR;
+            for (const std::string& line : this->framework_) {
+                out += line;
+                out += '\n';
+            }
+        } else {
+            for (size_t r = 0; r < height_; r++) {
+                const std::string& now = this->framework_[r];
+                const std::string& old = drawn_[r];
+                size_t c = 0;
+                while (c < width_) {
+                    if (now[c] == old[c]) { c++; continue; }
+                    size_t end = c + 1, last_diff = c;
+                    while (end < width_ && end - last_diff <= max_gap) {
+                        if (now[end] != old[end]) { last_diff = end; }
+                        end++;
+                    }
+                    move_cursor(out, r, c);
+                    out.append(now, c, last_diff + 1 - c);
+                    c = last_diff + 1;
+                }
+            }
+            move_cursor(out, height_, 0);
+            out += "\033[J";
+        }
+        std::cout.flush();  // keep the order with whatever cout still holds
+        size_t off = 0;
+        while (off < out.size()) {
+            ssize_t n = ::write(STDOUT_FILENO, out.data() + off, out.size() - off);
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                break;
+            }
+            off += n;
+        }
+        drawn_ = this->framework_;
+    }
+    static void move_cursor(std::string& out, size_t r, size_t c) {
+        out += "\033[";
+        out += std::to_string(r + 1);
+        out += ';';
+        out += std::to_string(c + 1);
+        out += 'H';
+    }
+    // absolute addressing only holds on a terminal tall enough to never scroll
+    static bool can_diff() {
+        if (!isatty(STDOUT_FILENO)) { return false; }
+        winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0 || ws.ws_row == 0) { return true; }
+        return ws.ws_row >= height_ + prompt_rows;
+    }
+
+    mutable std::vector<std::string> drawn_;  // what the screen shows now
 };  // endof class CmdDisplayer
 
 template <BoardSize Size=BoardSize::Small>
@@ -448,18 +626,24 @@ public:
 
     InferDisplayer() = delete;  // you must assign a board to begin deduction
     InferDisplayer(const std::vector<std::vector<size_t>>& board_) : base_type(board_) {}
+    explicit InferDisplayer(size_t n) : base_type(n) {}
 
+    // board: anything with snap(), only taken when the line wants the statuses
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-    void log_inference(size_t depth, const std::vector<std::vector<size_t>>&) const {
-        log_infer(depth, "deduction board:");
+    template <typename Board>
+    void log_inference(size_t depth, const Board&) const {
+        log_infer_at(depth, "deduction board:");
         for (const std::string& line : this->framework_) {
-            log_infer(XQ4GB_TIMESTAMP, depth, line.c_str());
+            log_infer_at(XQ4GB_TIMESTAMP, depth, line.c_str());
         }
     }
 #else  // __LOG_INFERENCE_ELSEWHERE__
-    void log_inference(size_t depth, const std::vector<std::vector<size_t>>& board) const {
-        std::string zipped_board = base_type::zip_tbl(board);
-        log_infer(depth, zipped_board.c_str());
+    template <typename Board>
+    void log_inference(size_t depth, const Board& board) const {
+        if (!log_on(INFER, INFER)) { return ; }
+        std::string packed_board = "# ";
+        packed_board += BoardCodec::encode(board.snap());
+        log_infer(depth, packed_board.c_str());
     }
 #endif  // __LOG_INFERENCE_ELSEWHERE__
 
@@ -676,8 +860,12 @@ public:
           menu1page_(PageType::Menu1, "Mode selection helper page"),
           menu2page_(PageType::Menu2, "Size selection helper page") {}
     
-    Command get_command() const {
-        return page_->get_command();
+    std::optional<Command> get_command(int timeout_ms) const {
+        return page_->get_command(timeout_ms);
+    }
+    // for the window's event thread: the click goes to the page on screen
+    void on_click(const PositionPix& pos) const {
+        page_->on_click(pos);
     }
     void show() const override {
         page_->show();
@@ -728,7 +916,7 @@ private:
     VickPage white_victory_page_;
     MenuPage menu1page_;
     MenuPage menu2page_;
-    Page* page_;  // do not manage memory with this ptr
+    Page* page_ = &game_page_;  // do not manage memory with this ptr, a game starts on its page
 
 };  // 
 
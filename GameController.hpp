@@ -19,11 +19,16 @@ public:
     virtual void restart_game_init() = 0;
     virtual void reset_game_init() = 0;
     virtual void abrupt_flush(GameStatus status) = 0;
+    // input from outside the board (a session, a script), played on the next human turn
+    virtual void post(const Command& cmd) = 0;
 };  // endof class GameController_base_base
 
 template <typename Player1_type, typename Player2_type, typename ChessBoard_type>  // TODO: type check
 class GameController_base : public GameController_base_base {
 public:
+    // how long one loop slice waits on human input
+    static constexpr int input_slice_ms = 100;
+
     GameController_base() 
         : board_(std::make_shared<ChessBoard_type>()), 
           player1_(board_, Piece::Color::Black), 
@@ -32,6 +37,8 @@ public:
           idle_player_(&player2_),
           player1_first_(true),
           /*logger_(),*/ archive_() {
+        board_->set_animation(!(std::is_base_of_v<RobotPlayer, Player1_type>
+                                && std::is_base_of_v<RobotPlayer, Player2_type>));
         _gc_init_();
     }
     virtual ~GameController_base() {}
@@ -58,7 +65,7 @@ public:
         } break;
         case CommandType::INVALID: {
             if (this->check_draw()) {
-                log_info("--- Draw ---");
+                log_at(CONTROLLER, INFO, "--- Draw ---");
                 return GameStatus::NORMAL;
             }
         } break;
@@ -70,24 +77,69 @@ public:
     }
     
     virtual void game_play_task(CommandType& cmd_type) {
-        do {
-            cmd_type = this->advance();
+        while (true) {
+            std::optional<CommandType> res = this->step(input_slice_ms);
+            if (!res.has_value()) { continue; }  // idle slice, nothing typed yet
+            cmd_type = *res;
             if (cmd_type != CommandType::PIECE) {
                 if (cmd_type == CommandType::XQ4GB) {
                     // log_new_game();
                     archive_.flush(GameStatus::XQ4GB);
+                    archive_.sync();  // execl skips the writer's destructor
                     execl("./xq4gb", "xq4gb", NULL);
                     exit(0x3F3F3F3F);
                 }
                 return ;
             }
-        } while (!this->check_end());
+            if (this->check_end()) { break; }
+        }
         // only is_end() == true comes here
         winner_display(idle_player_->get_color());
     }
     
+    // one slice of the game loop: a robot's search (on its own thread) or
+    // a human's next event is waited on for at most timeout_ms, < 0 until
+    // it comes, nullopt if none came
+    virtual std::optional<CommandType> step(int timeout_ms) {
+        if (!current_player_->needs_input()) { return this->step_robot(timeout_ms); }
+        std::optional<Command> cmd;
+        if (!events_.empty()) {
+            cmd = events_.front();
+            events_.pop_front();
+            // posted from outside, the board never saw it
+            if (cmd->type == CommandType::PIECE
+                && (!board_->is_valid_pos(cmd->pos.row, cmd->pos.col)
+                    || board_->get_status(cmd->pos.row, cmd->pos.col))) {
+                log_warn("Dropped a stale move: [%d, %d]", cmd->pos.row, cmd->pos.col);
+                prompted_ = false;  // ask again
+                return std::nullopt;
+            }
+        } else {
+            if (!prompted_) {
+                board_->prompt();
+                prompted_ = true;
+            }
+            cmd = board_->poll_command(timeout_ms);  // checked by the board
+            if (!cmd.has_value()) { return std::nullopt; }
+        }
+        prompted_ = false;
+        return this->advance(*cmd);
+    }
+    void post(const Command& cmd) override {
+        events_.push_back(cmd);
+    }
+    const ChessBoard_base& get_board() const { return *board_; }
+    bool waits_for_input() const { return current_player_->needs_input(); }
+
+    // blocking, the player asks the board itself
+    // (the server runs it on its pool, the loop goes through step)
     virtual CommandType advance() {
-        CommandType cmd_type = current_player_->play();
+        return after_play(current_player_->play());
+    }
+    virtual CommandType advance(const Command& cmd) {
+        return after_play(current_player_->play(cmd));
+    }
+    CommandType after_play(CommandType cmd_type) {
         if (cmd_type == CommandType::PIECE) {
             board_->refresh();
             Player* temp = current_player_;
@@ -95,6 +147,7 @@ public:
             idle_player_ = temp;
             // log_info("step");
             archive_.record(board_->serialize());
+            log_board_snapshot();
         }
         return cmd_type;
     }
@@ -115,6 +168,8 @@ public:
         
         log_new_game(board_->size(), board_->size());
         board_->reset();
+        move_cnt_ = 0;
+        clear_events();
         // board_->show();
         // doesnt swap
         if (player1_first_) {
@@ -132,6 +187,8 @@ public:
     virtual void reset_game_init() override {
         log_new_game(board_->size(), board_->size());
         board_->reset();
+        move_cnt_ = 0;
+        clear_events();
         // board_->show();
         std::swap(player1_.get_color(), player2_.get_color());
         player1_first_ = !player1_first_;
@@ -151,6 +208,46 @@ protected:
     virtual void winner_display(const Piece::Color& color) const {
         board_->winner_display(color);
     }
+    void clear_events() {
+        events_.clear();
+        prompted_ = false;
+        thinking_ = {};  // a search still running is waited out, its move thrown away
+    }
+    // the search starts on the first slice of the turn, the move is placed
+    // on the loop's thread once it is ready: nothing else touches the board
+    // while the robot is to move
+    std::optional<CommandType> step_robot(int timeout_ms) {
+        if (!thinking_.valid()) {
+            const Player* player = current_player_;
+            thinking_ = std::async(std::launch::async, [player]() { return player->think(); });
+        }
+        if (timeout_ms >= 0
+            && thinking_.wait_for(std::chrono::milliseconds(timeout_ms)) != std::future_status::ready) {
+            return std::nullopt;
+        }
+        return this->advance(Command{CommandType::PIECE, thinking_.get()});
+    }
+    // once per move, instead of once per redraw
+    void log_board_snapshot() {
+        move_cnt_++;
+        switch (BOARD_LOG_MODE) {
+        case BoardLogMode::MOVE : {
+            const Piece& p = board_->get_last_piece();
+            log_at(CONTROLLER, DEBUG, "Move #%lu: %s [%d, %d]", move_cnt_,
+                                      Piece::is_same_color(p.color, Piece::Color::Black) ? "black" : "white",
+                                      p.row, p.col);
+        } break;
+        case BoardLogMode::ZIPPED : {
+            log_at(CONTROLLER, DEBUG, "Move #%lu board: %s", move_cnt_,
+                                      Displayer_base_base::zip_rle(board_->snap()).c_str());
+        } break;
+        case BoardLogMode::FULL : {
+            board_->log_board();
+        } break;
+        default:
+            break;
+        }
+    }
 private:
     virtual void _gc_init_() {
         // in init list now
@@ -161,24 +258,24 @@ private:
         // archive_.flush();
 
         // log
-        log_info("game controller inits...");
-        log_debug("------------------------------");
-        log_debug("player1 color: %s", 
-                  (Piece::get_real_status(player1_.get_color_const()) 
-                   == Piece::get_real_status(Piece::Color::White) ? "White" : "Black"));
-        log_debug("player2 color: %s", 
-                  (Piece::get_real_status(player2_.get_color_const()) 
-                   == Piece::get_real_status(Piece::Color::White) ? "White" : "Black"));
-        log_debug("player1 plays first: %s", (player1_first_ ? "True" : "False"));
-        log_debug("current player: %s", (current_player_ == &player1_ ? "Player1" : "Player2"));
-        log_debug("idle_:D player: %s", (idle_player_ == &player1_ ? "Player1" : "Player2"));  // :D
+        log_at(CONTROLLER, INFO, "game controller inits...");
+        log_at(CONTROLLER, DEBUG, "------------------------------");
+        log_at(CONTROLLER, DEBUG, "player1 color: %s", 
+                                  (Piece::get_real_status(player1_.get_color_const()) 
+                                   == Piece::get_real_status(Piece::Color::White) ? "White" : "Black"));
+        log_at(CONTROLLER, DEBUG, "player2 color: %s", 
+                                  (Piece::get_real_status(player2_.get_color_const()) 
+                                   == Piece::get_real_status(Piece::Color::White) ? "White" : "Black"));
+        log_at(CONTROLLER, DEBUG, "player1 plays first: %s", (player1_first_ ? "True" : "False"));
+        log_at(CONTROLLER, DEBUG, "current player: %s", (current_player_ == &player1_ ? "Player1" : "Player2"));
+        log_at(CONTROLLER, DEBUG, "idle_:D player: %s", (idle_player_ == &player1_ ? "Player1" : "Player2"));  // :D
         if (archive_.get_status() == true) {
-            log_debug("archive status: online");
+            log_at(CONTROLLER, DEBUG, "archive status: online");
         } else {
             log_error("archive status: offline");
             log_error(XQ4GB_TIMESTAMP, "your archive may be lost");
         }
-        log_debug("------------------------------");
+        log_at(CONTROLLER, DEBUG, "------------------------------");
         // show CHECK: we really need this?
         // board_->show();
     }
@@ -197,9 +294,13 @@ private:
     Player* current_player_;  // doesnt alloc any mem
     Player* idle_player_;
     bool player1_first_;
+    size_t move_cnt_ = 0;
+    std::deque<Command> events_;
+    bool prompted_ = false;  // the board has asked for this turn's input
 
     Archive<ChessBoard_type> archive_;
     // std::vector<typename ChessBoard_type::Archive_type> archive_; 
+    std::future<Position> thinking_;  // last: a running search is waited out before the players go
 
 };  // endof class GameController_base
 
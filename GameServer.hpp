@@ -0,0 +1,495 @@
+#ifndef __GAMESERVER_HPP__
+#define __GAMESERVER_HPP__
+
+#include "GameController.hpp"
+#include "BoardCodec.hpp"
+#include "ThreadPool.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace mfwu {
+
+/*
+    many games in one process: one epoll thread owns every socket and
+    every session, robot searches go to a shared ThreadPool and come
+    back through an eventfd. one Logger, one ArchiveWriter for all
+
+    line protocol, one command per line, each gets one "OK ..." or "ERR ..."
+        NEW [13|19|25] [BLACK|WHITE]   new game, you play BLACK by default
+        PLAY <rc>                      your move, two letters like the cmd board ("hh")
+        BOARD                          BOARD <BoardCodec payload>, the last game's once it ends
+        RESIGN | PING | HELP | QUIT
+    and the server pushes, whenever they happen
+        MOVE <rc>                      the robot's move
+        END BLACK|WHITE|DRAW
+    lines sent while the robot thinks wait for its move, in order
+*/
+
+// a game the server drives: moves are posted to the controller as events,
+// the board itself is never asked
+class ServerGame_base {
+public:
+    enum class State : size_t { HUMAN, ROBOT, OVER };
+
+    virtual ~ServerGame_base() {}
+    virtual State get_state() const = 0;
+    // false if it is not the human's turn or not a legal move
+    virtual bool play_human(const Position& pos) = 0;
+    // the slow one, runs on the pool
+    virtual void play_robot() = 0;
+    virtual void resign() = 0;
+    virtual const ChessBoard_base& get_board() const = 0;
+    virtual Piece::Color get_human_color() const = 0;
+    virtual Piece::Color get_winner() const = 0;  // Invalid for a draw
+};  // endof class ServerGame_base
+
+template <typename Player1_type, typename Player2_type, BoardSize Size>
+class ServerGame : public ServerGame_base {
+public:
+    static constexpr size_t size_ = static_cast<size_t>(Size);
+
+    ServerGame() {
+        log_new_game(size_, size_);
+        state_ = controller_.waits_for_input() ? State::HUMAN : State::ROBOT;
+    }
+    ~ServerGame() {
+        if (state_ != State::OVER) { controller_.abrupt_flush(GameStatus::QUIT); }
+    }
+
+    State get_state() const override { return state_; }
+    bool play_human(const Position& pos) override {
+        const ChessBoard_base& board = controller_.get_board();
+        if (state_ != State::HUMAN
+            || !board.is_valid_pos(pos.row, pos.col)
+            || board.get_status(pos.row, pos.col)) {
+            return false;
+        }
+        controller_.post(Command{CommandType::PIECE, pos});
+        after_move(controller_.step(0));
+        return true;
+    }
+    void play_robot() override {
+        if (state_ != State::ROBOT) { return ; }
+        after_move(controller_.advance());  // already on the pool, no need for step's own thread
+    }
+    void resign() override {
+        if (state_ == State::OVER) { return ; }
+        finish(get_human_color() == Piece::Color::Black ? Piece::Color::White
+                                                        : Piece::Color::Black);
+    }
+    const ChessBoard_base& get_board() const override { return controller_.get_board(); }
+    Piece::Color get_human_color() const override {
+        return std::is_same_v<Player1_type, HumanPlayer> ? Piece::Color::Black
+                                                         : Piece::Color::White;
+    }
+    Piece::Color get_winner() const override { return winner_; }
+
+private:
+    void after_move(std::optional<CommandType> res) {
+        if (res != CommandType::PIECE) {  // the robot found no move: full board
+            finish(Piece::Color::Invalid);
+        } else if (controller_.check_end()) {
+            const Piece& p = controller_.get_board().get_last_piece();
+            finish(Piece::is_same_color(p.color, Piece::Color::Black) ? Piece::Color::Black
+                                                                      : Piece::Color::White);
+        } else if (controller_.check_draw()) {
+            finish(Piece::Color::Invalid);
+        } else {
+            state_ = controller_.waits_for_input() ? State::HUMAN : State::ROBOT;
+        }
+    }
+    void finish(Piece::Color winner) {
+        winner_ = winner;
+        state_ = State::OVER;
+        controller_.abrupt_flush(GameStatus::NORMAL);
+    }
+
+    GameController_base<Player1_type, Player2_type, HeadlessBoard<Size>> controller_;
+    State state_;
+    Piece::Color winner_ = Piece::Color::Invalid;
+};  // endof class ServerGame
+
+inline std::shared_ptr<ServerGame_base> make_server_game(BoardSize size, bool human_black) {
+    using Robot_type = HumanLikeRobot;
+    switch (size) {
+    case BoardSize::Small :
+        if (human_black) { return std::make_shared<ServerGame<HumanPlayer, Robot_type, BoardSize::Small>>(); }
+        return std::make_shared<ServerGame<Robot_type, HumanPlayer, BoardSize::Small>>();
+    case BoardSize::Middle :
+        if (human_black) { return std::make_shared<ServerGame<HumanPlayer, Robot_type, BoardSize::Middle>>(); }
+        return std::make_shared<ServerGame<Robot_type, HumanPlayer, BoardSize::Middle>>();
+    case BoardSize::Large :
+        if (human_black) { return std::make_shared<ServerGame<HumanPlayer, Robot_type, BoardSize::Large>>(); }
+        return std::make_shared<ServerGame<Robot_type, HumanPlayer, BoardSize::Large>>();
+    default:
+        return nullptr;
+    }
+}
+
+struct ServerOptions {
+    std::string tcp_host = "127.0.0.1";
+    int tcp_port = 0;              // 0: no tcp
+    std::string unix_path = "";    // "": no unix socket
+    size_t workers = std::max(1U, std::thread::hardware_concurrency());
+    size_t max_sessions = 1024;
+    size_t max_line = 1024;        // longer lines drop the client
+};  // endof struct ServerOptions
+
+class GameServer {
+public:
+    GameServer(const ServerOptions& opt)
+        : opt_(opt), pool_(std::make_unique<ThreadPool>(opt.workers)) {}
+    ~GameServer() {
+        pool_.reset();  // searches still out write to event_fd_
+        for (auto& [fd, s] : sessions_) { ::close(fd); }
+        for (int fd : listen_fds_) { ::close(fd); }
+        if (!opt_.unix_path.empty() && !listen_fds_.empty()) { ::unlink(opt_.unix_path.c_str()); }
+        if (event_fd_ >= 0) { ::close(event_fd_); }
+        if (epoll_fd_ >= 0) { ::close(epoll_fd_); }
+    }
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    bool listen() {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || event_fd_ < 0) {
+            log_error("server: epoll/eventfd: %s", strerror(errno));
+            return false;
+        }
+        watch(event_fd_, EPOLLIN);
+        if (opt_.tcp_port > 0 && !listen_tcp()) { return false; }
+        if (!opt_.unix_path.empty() && !listen_unix()) { return false; }
+        if (listen_fds_.empty()) {
+            log_error("server: nothing to listen on");
+            return false;
+        }
+        return true;
+    }
+    // until stop()
+    void run() {
+        std::vector<epoll_event> evs(64);
+        while (!stop_.load()) {
+            int n = ::epoll_wait(epoll_fd_, evs.data(), evs.size(), -1);
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                log_error("server: epoll_wait: %s", strerror(errno));
+                return ;
+            }
+            for (int i = 0; i < n; i++) {
+                int fd = evs[i].data.fd;
+                if (fd == event_fd_) {
+                    on_done();
+                } else if (std::find(listen_fds_.begin(), listen_fds_.end(), fd) != listen_fds_.end()) {
+                    on_accept(fd);
+                } else {
+                    on_client(fd, evs[i].events);
+                }
+            }
+        }
+    }
+    // async-signal-safe
+    void stop() {
+        stop_.store(true);
+        uint64_t one = 1;
+        (void)!::write(event_fd_, &one, sizeof(one));
+    }
+    size_t get_session_num() const { return sessions_.size(); }
+
+private:
+    struct Session {
+        int fd;
+        uint64_t id;  // fds are reused, ids are not
+        std::string in, out;
+        std::shared_ptr<ServerGame_base> game;
+        bool busy = false;     // a robot search is out on the pool
+        bool closing = false;  // close once `out` is sent
+        bool eof = false;      // the client sent all it will, what came is still answered
+        bool want_out = false;  // EPOLLOUT is on
+    };  // endof struct Session
+
+    bool listen_tcp() {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opt_.tcp_port);
+        if (::inet_pton(AF_INET, opt_.tcp_host.c_str(), &addr.sin_addr) != 1
+            || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::listen(fd, SOMAXCONN) != 0) {
+            log_error("server: cannot listen on %s:%d: %s",
+                      opt_.tcp_host.c_str(), opt_.tcp_port, strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        listen_fds_.push_back(fd);
+        watch(fd, EPOLLIN);
+        return true;
+    }
+    bool listen_unix() {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (opt_.unix_path.size() >= sizeof(addr.sun_path)) {
+            log_error("server: socket path too long: %s", opt_.unix_path.c_str());
+            ::close(fd);
+            return false;
+        }
+        strcpy(addr.sun_path, opt_.unix_path.c_str());
+        ::unlink(addr.sun_path);  // left by a crashed run
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::listen(fd, SOMAXCONN) != 0) {
+            log_error("server: cannot listen on %s: %s", opt_.unix_path.c_str(), strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        listen_fds_.push_back(fd);
+        watch(fd, EPOLLIN);
+        return true;
+    }
+    void watch(int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+    void rewatch(int fd, uint32_t events) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    void on_accept(int lfd) {
+        while (true) {
+            int fd = ::accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) { return ; }  // EAGAIN: all taken
+            if (sessions_.size() >= opt_.max_sessions) {
+                const char* msg = "ERR server full\n";
+                (void)!::send(fd, msg, strlen(msg), MSG_NOSIGNAL);
+                ::close(fd);
+                continue;
+            }
+            Session& s = sessions_[fd];
+            s.fd = fd;
+            s.id = ++last_id_;
+            watch(fd, EPOLLIN | EPOLLRDHUP);
+            log_info("server: session %lu in, %lu online", s.id, sessions_.size());
+        }
+    }
+    void on_client(int fd, uint32_t events) {
+        auto it = sessions_.find(fd);
+        if (it == sessions_.end()) { return ; }
+        Session& s = it->second;
+        if (events & EPOLLOUT) { send_out(s); }
+        if (s.eof && (events & (EPOLLHUP | EPOLLERR))) {  // gone both ways, nobody to answer
+            close_session(fd);
+            return ;
+        }
+        if (!s.eof && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+            char buf[4096];
+            while (true) {
+                ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                if (n > 0) {
+                    s.in.append(buf, n);
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { break; }
+                if (n < 0 && errno == EINTR) { continue; }
+                if (n < 0) {  // error
+                    close_session(fd);
+                    return ;
+                }
+                // eof: no more reads, maybe_close waits for the answers
+                s.eof = true;
+                rewatch_session(s);
+                break;
+            }
+            handle_lines(s);
+        }
+        maybe_close(fd);
+    }
+    // robot moves that came back from the pool
+    void on_done() {
+        uint64_t cnt;
+        (void)!::read(event_fd_, &cnt, sizeof(cnt));
+        std::vector<std::pair<int, uint64_t>> done;
+        {
+            std::lock_guard<std::mutex> lk(done_mtx_);
+            done.swap(done_);
+        }
+        for (auto [fd, id] : done) {
+            auto it = sessions_.find(fd);
+            if (it == sessions_.end() || it->second.id != id) { continue; }  // left meanwhile
+            Session& s = it->second;
+            s.busy = false;
+            const Piece& p = s.game->get_board().get_last_piece();
+            if (p.get_status() != 0 && !Piece::is_same_color(p.color, s.game->get_human_color())) {
+                reply(s, std::string("MOVE ") + to_move_str(p));
+            }
+            report_end(s);
+            handle_lines(s);
+            maybe_close(fd);
+        }
+    }
+
+    void handle_lines(Session& s) {
+        size_t beg = 0, end;
+        while (!s.busy && !s.closing && (end = s.in.find('\n', beg)) != std::string::npos) {
+            std::string line = s.in.substr(beg, end - beg);
+            beg = end + 1;
+            if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+            handle_command(s, line);
+        }
+        s.in.erase(0, beg);
+        if (s.in.size() > opt_.max_line && s.in.find('\n') == std::string::npos) {
+            reply(s, "ERR line too long");
+            s.closing = true;
+        }
+    }
+    void handle_command(Session& s, const std::string& line) {
+        std::istringstream ss(line);
+        std::string cmd, arg1, arg2;
+        ss >> cmd >> arg1 >> arg2;
+        toupper(cmd);
+        toupper(arg1);
+        toupper(arg2);
+        if (cmd.empty()) { return ; }
+        if (cmd == "NEW") {
+            size_t size = arg1.empty() ? static_cast<size_t>(BoardSize::Small) : atoi(arg1.c_str());
+            if (arg2 != "" && arg2 != "BLACK" && arg2 != "WHITE") {
+                reply(s, "ERR color is BLACK or WHITE");
+                return ;
+            }
+            s.game = make_server_game(BoardSize{size}, arg2 != "WHITE");
+            if (s.game == nullptr) {
+                reply(s, "ERR size is 13, 19 or 25");
+                return ;
+            }
+            reply(s, "OK NEW " + std::to_string(size) + (arg2 == "WHITE" ? " WHITE" : " BLACK"));
+            think(s);
+        } else if (cmd == "PLAY") {
+            if (s.game == nullptr) { reply(s, "ERR no game"); return ; }
+            if (s.game->get_state() != ServerGame_base::State::HUMAN) { reply(s, "ERR game over"); return ; }
+            Position pos = parse_move_str(arg1);
+            if (!s.game->play_human(pos)) { reply(s, "ERR illegal move"); return ; }
+            reply(s, "OK PLAY " + to_move_str(pos));
+            report_end(s);
+            think(s);
+        } else if (cmd == "BOARD") {
+            if (s.game == nullptr) { reply(s, "ERR no game"); return ; }
+            reply(s, "BOARD " + BoardCodec::encode(s.game->get_board().snap()));
+        } else if (cmd == "RESIGN") {
+            if (s.game == nullptr) { reply(s, "ERR no game"); return ; }
+            if (s.game->get_state() == ServerGame_base::State::OVER) { reply(s, "ERR game over"); return ; }
+            s.game->resign();
+            reply(s, "OK RESIGN");
+            report_end(s);
+        } else if (cmd == "PING") {
+            reply(s, "OK PING");
+        } else if (cmd == "HELP") {
+            reply(s, "OK NEW [13|19|25] [BLACK|WHITE], PLAY <rc>, BOARD, RESIGN, PING, QUIT");
+        } else if (cmd == "QUIT") {
+            reply(s, "OK BYE");
+            s.closing = true;
+        } else {
+            reply(s, "ERR unknown command, try HELP");
+        }
+    }
+    // the robot's turn: off to the pool, the session waits
+    void think(Session& s) {
+        if (s.game->get_state() != ServerGame_base::State::ROBOT) { return ; }
+        s.busy = true;
+        pool_->submit([this, game=s.game, fd=s.fd, id=s.id]() {
+            game->play_robot();
+            {
+                std::lock_guard<std::mutex> lk(done_mtx_);
+                done_.emplace_back(fd, id);
+            }
+            uint64_t one = 1;
+            (void)!::write(event_fd_, &one, sizeof(one));
+        });
+    }
+    void report_end(Session& s) {
+        if (s.game == nullptr || s.game->get_state() != ServerGame_base::State::OVER) { return ; }
+        Piece::Color winner = s.game->get_winner();
+        reply(s, winner == Piece::Color::Invalid ? "END DRAW"
+                 : winner == Piece::Color::Black ? "END BLACK" : "END WHITE");
+    }
+
+    void reply(Session& s, const std::string& line) {
+        s.out += line;
+        s.out += '\n';
+        send_out(s);
+    }
+    void send_out(Session& s) {
+        size_t sent = 0;
+        while (sent < s.out.size()) {
+            ssize_t n = ::send(s.fd, s.out.data() + sent, s.out.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) { sent += n; continue; }
+            if (n < 0 && errno == EINTR) { continue; }
+            break;  // EAGAIN, or broken: the next read tells
+        }
+        s.out.erase(0, sent);
+        // EPOLLOUT only while something is stuck
+        bool stuck = !s.out.empty();
+        if (stuck != s.want_out) {
+            s.want_out = stuck;
+            rewatch_session(s);
+        }
+    }
+    // no EPOLLIN after eof, it would fire for ever
+    void rewatch_session(const Session& s) {
+        uint32_t in = s.eof ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP);
+        rewatch(s.fd, in | (s.want_out ? static_cast<uint32_t>(EPOLLOUT) : 0u));
+    }
+    // after QUIT, or after eof once every line is answered and no search is out
+    void maybe_close(int fd) {
+        auto it = sessions_.find(fd);
+        if (it == sessions_.end()) { return ; }
+        const Session& s = it->second;
+        if ((s.closing || (s.eof && !s.busy)) && s.out.empty()) {
+            close_session(fd);
+        }
+    }
+    void close_session(int fd) {
+        auto it = sessions_.find(fd);
+        if (it == sessions_.end()) { return ; }
+        log_info("server: session %lu out", it->second.id);
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        sessions_.erase(it);  // a search still out keeps its game alive
+    }
+
+    static std::string to_move_str(const Position& pos) {
+        return {static_cast<char>('a' + pos.row), static_cast<char>('a' + pos.col)};
+    }
+    // "HH" (already upper) -> [7, 7], [-1, -1] if broken
+    static Position parse_move_str(const std::string& str) {
+        if (str.size() != 2 || !is_uppercase(str[0]) || !is_uppercase(str[1])) { return {}; }
+        return {str[0] - 'A', str[1] - 'A'};
+    }
+
+    ServerOptions opt_;
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    std::vector<int> listen_fds_;
+    std::unordered_map<int, Session> sessions_;
+    uint64_t last_id_ = 0;
+    std::atomic<bool> stop_ = false;
+
+    std::mutex done_mtx_;
+    std::vector<std::pair<int, uint64_t>> done_;
+    std::unique_ptr<ThreadPool> pool_;
+};  // endof class GameServer
+
+}  // endof namespace mfwu
+
+#endif  // __GAMESERVER_HPP__
@@ -11,8 +11,11 @@ public:
     HumanPlayer(std::shared_ptr<ChessBoard_base> board, Piece::Color color) 
         : Player(board, color) {}
 
+    // blocks on the board
     virtual CommandType play() override {
-        Command cmd = this->board_->get_command();
+        return play(this->board_->get_command());
+    }
+    virtual CommandType play(const Command& cmd) override {
         log_debug("Human player puts cmd: %s", 
                   CommandTypeDescription.at(static_cast<size_t>(cmd.type)).c_str());
         switch (cmd.type) {
@@ -37,6 +40,7 @@ public:
         }
         return cmd.type;
     }
+    bool needs_input() const override { return true; }
 
     void place(const Position& pos) override {
         return Player::place(pos);
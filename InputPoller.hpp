@@ -0,0 +1,117 @@
+#ifndef __INPUTPOLLER_HPP__
+#define __INPUTPOLLER_HPP__
+
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include <poll.h>
+
+namespace mfwu {
+
+/*
+    stdin without blocking reads: poll first, then read what is there
+    into a buffer, so the caller decides how long it can wait and the
+    game loop never sits inside `std::cin >>`
+
+    timeout_ms: 0 returns at once, < 0 waits until something comes
+    every stdin reader of the app goes through InputPoller::get(),
+    mixing it with std::cin would lose whatever is buffered here
+*/
+class InputPoller {
+public:
+    static InputPoller& get() {
+        static InputPoller poller(STDIN_FILENO);
+        return poller;
+    }
+
+    explicit InputPoller(int fd) : fd_(fd) {}
+    InputPoller(const InputPoller&) = delete;
+    InputPoller& operator=(const InputPoller&) = delete;
+
+    int get_fd() const { return fd_; }
+    bool eof() const { return eof_ && buf_.empty(); }
+
+    // next whitespace separated word, like `std::cin >> str`
+    // nullopt on timeout, or at eof with nothing left
+    std::optional<std::string> next_word(int timeout_ms) {
+        const auto deadline = get_deadline(timeout_ms);
+        while (true) {
+            size_t beg = buf_.find_first_not_of(" \t\r\n");
+            if (beg == std::string::npos) {
+                buf_.clear();
+            } else {
+                size_t end = buf_.find_first_of(" \t\r\n", beg);
+                if (end != std::string::npos || eof_) {
+                    std::string ret = buf_.substr(beg, end - beg);
+                    buf_.erase(0, end == std::string::npos ? buf_.size() : end);
+                    return ret;
+                }
+            }
+            if (eof_ || !fill(time_left(deadline, timeout_ms))) { return std::nullopt; }
+        }
+    }
+    // next line without its '\n'
+    std::optional<std::string> next_line(int timeout_ms) {
+        const auto deadline = get_deadline(timeout_ms);
+        while (true) {
+            size_t end = buf_.find('\n');
+            if (end != std::string::npos || (eof_ && !buf_.empty())) {
+                std::string ret = buf_.substr(0, end);
+                buf_.erase(0, end == std::string::npos ? buf_.size() : end + 1);
+                return ret;
+            }
+            if (eof_ || !fill(time_left(deadline, timeout_ms))) { return std::nullopt; }
+        }
+    }
+    // true if a read would not block: something buffered, typed, or eof
+    bool wait_readable(int timeout_ms) {
+        if (!buf_.empty() || eof_) { return true; }
+        return fill(timeout_ms);
+    }
+    // drops what is buffered and whatever was typed so far, never blocks
+    void discard() {
+        buf_.clear();
+        while (fill(0) && !eof_) { buf_.clear(); }
+        buf_.clear();
+    }
+
+private:
+    using clock_type = std::chrono::steady_clock;
+
+    static clock_type::time_point get_deadline(int timeout_ms) {
+        return clock_type::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+    }
+    static int time_left(clock_type::time_point deadline, int timeout_ms) {
+        if (timeout_ms < 0) { return -1; }
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_type::now());
+        return std::max<int>(left.count(), 0);
+    }
+    // one poll + one read, false if nothing came in time
+    bool fill(int timeout_ms) {
+        std::cout.flush();  // prompts first, std::cin used to do this for us
+        pollfd pfd{fd_, POLLIN, 0};
+        int ret;
+        do {
+            ret = ::poll(&pfd, 1, timeout_ms);
+        } while (ret < 0 && errno == EINTR);
+        if (ret <= 0) { return false; }
+        char tmp[4096];
+        ssize_t n;
+        do {
+            n = ::read(fd_, tmp, sizeof(tmp));
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            eof_ = true;  // closed, or broken for good
+        } else {
+            buf_.append(tmp, n);
+        }
+        return true;
+    }
+
+    int fd_;
+    std::string buf_;
+    bool eof_ = false;
+};  // endof class InputPoller
+
+}  // endof namespace mfwu
+
+#endif  // __INPUTPOLLER_HPP__
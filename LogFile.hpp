@@ -0,0 +1,227 @@
+#ifndef __LOGFILE_HPP__
+#define __LOGFILE_HPP__
+
+#include "common.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace mfwu {
+
+/*
+    a log file that rolls over like the archive segments do:
+        <base><ext>, <base>.1<ext>, <base>.2<ext>, ...
+    by size, by game count or by age, whichever comes first
+    every closed segment gets a line in <base>.manifest:
+        name \t bytes \t games \t first unix time \t last unix time
+
+    disk space is reserved ahead of the write position with fallocate,
+    prealloc_bytes at a time, so endless small appends don't fragment the
+    file system; plain writes reserve with KEEP_SIZE, the file never shows
+    more than what was written
+    with use_mmap lines are copied into a mapped window of the file instead
+    of write()s, the file is cut back to the written size on rollover and
+    on close (a crash leaves zeros at the end); not for processes that fork
+*/
+struct LogRotation {
+    size_t max_bytes = 64UL << 20;  // 0: no limit
+    size_t max_games = 0;           // 0: no limit
+    time_t max_seconds = 0;         // 0: no limit
+    bool whole_games = false;       // roll over at game ends only (inference: a game per file)
+    size_t prealloc_bytes = 4UL << 20;  // 0: no preallocation
+    bool use_mmap = false;
+};  // endof struct LogRotation
+
+class LogFile {
+public:
+    static constexpr size_t buffer_bytes = 1UL << 16;  // write() path
+
+    LogFile(const std::string& base, const std::string& ext, const LogRotation& rot)
+        : base_(base), ext_(ext), rot_(rot) {
+        if (rot_.use_mmap) {
+            size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            map_bytes_ = std::max(rot_.prealloc_bytes, page);
+            map_bytes_ = (map_bytes_ + page - 1) / page * page;
+        }
+        filename_ = segment_name(index_);
+    }
+    // {base, ext}
+    LogFile(const std::pair<std::string, std::string>& name, const LogRotation& rot)
+        : LogFile(name.first, name.second, rot) {}
+    ~LogFile() { close_segment(); }
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    const std::string& get_filename() const { return filename_; }
+    size_t get_index() const { return index_; }
+
+    void write(std::string_view str) {
+        if (!rot_.whole_games && due()) { roll_over(); }
+        if (fd_ < 0 && !open_segment()) { return ; }
+        if (first_time_ == 0) { first_time_ = time(0); }
+        if (rot_.use_mmap) {
+            map_write(str.data(), str.size());
+        } else {
+            buf_.append(str.data(), str.size());
+            if (buf_.size() >= buffer_bytes) { flush(); }
+        }
+        bytes_ += str.size();
+    }
+    // what is buffered goes to the file (page cache), no fsync
+    void flush() {
+        if (fd_ < 0 || buf_.empty()) { return ; }
+        reserve();
+        const char* p = buf_.data();
+        size_t left = buf_.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd_, p, left);
+            if (n < 0 && errno == EINTR) { continue; }
+            if (n <= 0) { break; }  // disk full or worse, the lines are lost
+            p += n; left -= n;
+        }
+        buf_.clear();
+    }
+    void end_game() {
+        if (fd_ < 0) { return ; }
+        games_++;
+        if (due()) { roll_over(); }
+    }
+
+private:
+    bool due() const {
+        if (fd_ < 0 || bytes_ == 0) { return false; }  // never an empty segment
+        if (rot_.max_bytes && bytes_ >= rot_.max_bytes) { return true; }
+        if (rot_.max_games && games_ >= rot_.max_games) { return true; }
+        if (rot_.max_seconds && first_time_ && time(0) - first_time_ >= rot_.max_seconds) { return true; }
+        return false;
+    }
+    // the next segment is opened by the next write, no empty files
+    void roll_over() {
+        close_segment();
+        index_++;
+        filename_ = segment_name(index_);
+    }
+    std::string segment_name(size_t index) const {
+        if (index == 0) { return base_ + ext_; }
+        return base_ + '.' + std::to_string(index) + ext_;
+    }
+    bool open_segment() {
+        if (open_failed_) { return false; }
+        bytes_ = 0;
+        games_ = 0;
+        first_time_ = 0;
+        reserved_ = 0;
+        int flags = O_CREAT | O_CLOEXEC | (rot_.use_mmap ? O_RDWR : O_WRONLY | O_APPEND);
+        fd_ = ::open(filename_.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            std::cerr << "cannot open " << filename_ << ", log lines will be lost\n";
+            open_failed_ = true;
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd_, &st) == 0) { bytes_ = st.st_size; }  // same name again: append
+        if (rot_.use_mmap) { map_window(bytes_); }
+        return true;
+    }
+    void close_segment() {
+        if (fd_ < 0) { return ; }
+        if (rot_.use_mmap) { unmap(); } else { flush(); }
+        // the mapped tail is cut off; a write() file may have other writers
+        // appending too (same name, same second), bytes_ doesn't know their
+        // lines: only the blocks reserved past the real end are given back
+        off_t size = static_cast<off_t>(bytes_);
+        bool cut = rot_.use_mmap;
+        struct stat st;
+        if (!rot_.use_mmap && reserved_ > 0 && ::fstat(fd_, &st) == 0) {
+            size = st.st_size;
+            cut = static_cast<size_t>(size) < reserved_;
+        }
+        if (cut && ::ftruncate(fd_, size) != 0) {
+            std::cerr << "cannot cut " << filename_ << " back to its size\n";
+        }
+        ::close(fd_);
+        fd_ = -1;
+        append_manifest();
+    }
+    void append_manifest() const {
+        std::string line = std::filesystem::path(filename_).filename().string();
+        line += '\t'; line += std::to_string(bytes_);
+        line += '\t'; line += std::to_string(games_);
+        line += '\t'; line += std::to_string(first_time_);
+        line += '\t'; line += std::to_string(time(0));
+        line += '\n';
+        int fd = ::open((base_ + ".manifest").c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) { return ; }
+        if (::write(fd, line.data(), line.size()) != static_cast<ssize_t>(line.size())) {
+            std::cerr << "manifest " << base_ << ".manifest may be incomplete\n";
+        }
+        ::close(fd);
+    }
+    // make sure [0, bytes_) is backed by reserved blocks, bytes_ counts buf_ already
+    void reserve() {
+        if (rot_.prealloc_bytes == 0) { return ; }
+        size_t need = bytes_;
+        if (need <= reserved_) { return ; }
+        size_t to = (need / rot_.prealloc_bytes + 1) * rot_.prealloc_bytes;
+        // not every fs can, then it's plain appends as before
+        if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, to) == 0) { reserved_ = to; }
+        else { rot_.prealloc_bytes = 0; }
+    }
+
+    // ---- mmap path ----
+    void map_window(size_t pos) {
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        map_off_ = pos / page * page;
+        size_t end = map_off_ + map_bytes_;
+        // the mapping needs real file size under it
+        if (::fallocate(fd_, 0, map_off_, map_bytes_) != 0 && ::ftruncate(fd_, end) != 0) {
+            std::cerr << "cannot extend " << filename_ << ", log lines will be lost\n";
+            return ;
+        }
+        void* p = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, map_off_);
+        if (p == MAP_FAILED) {
+            std::cerr << "cannot map " << filename_ << ", log lines will be lost\n";
+            return ;
+        }
+        map_ = static_cast<char*>(p);
+    }
+    void unmap() {
+        if (map_ == nullptr) { return ; }
+        ::munmap(map_, map_bytes_);
+        map_ = nullptr;
+    }
+    void map_write(const char* p, size_t n) {
+        size_t pos = bytes_;
+        while (n > 0) {
+            if (map_ == nullptr || pos >= map_off_ + map_bytes_) {
+                unmap();
+                map_window(pos);
+                if (map_ == nullptr) { return ; }
+            }
+            size_t k = std::min(n, map_off_ + map_bytes_ - pos);
+            memcpy(map_ + (pos - map_off_), p, k);
+            p += k; n -= k; pos += k;
+        }
+    }
+
+    std::string base_;
+    std::string ext_;
+    LogRotation rot_;
+    std::string filename_;
+    int fd_ = -1;  // -1: not opened yet
+    bool open_failed_ = false;
+    size_t index_ = 0;
+    size_t bytes_ = 0;
+    size_t games_ = 0;
+    time_t first_time_ = 0;
+    size_t reserved_ = 0;
+    std::string buf_;
+    char* map_ = nullptr;
+    size_t map_off_ = 0;
+    size_t map_bytes_ = 0;
+};  // endof class LogFile
+
+}  // endof namespace mfwu
+
+#endif  // __LOGFILE_HPP__
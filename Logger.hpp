@@ -2,6 +2,9 @@
 #define __LOGGER_HPP__
 
 #include "common.hpp"
+#include "LogFile.hpp"
+#include <sys/syscall.h>
+#include <pthread.h>
 
 namespace mfwu {
 
@@ -15,58 +18,120 @@ enum class LogLevel : size_t {
     TOTAL
 };  // endof enum class LogLevel
 
+// which part of the app a call site belongs to, see log_at()
+enum class LogCategory : size_t {
+    GENERAL    = 0,
+    INFER      = 1,  // robot search: candidates, deduction boards
+    BOARD      = 2,  // chess board / displayers
+    CONTROLLER = 3,  // game controller: moves, game setup
+};  // endof enum class LogCategory
+
+// compile-time filtering, define before including anything:
+//   #define __LOG_MIN_LEVEL__ 3  : only WARN and ERROR are left
+//   #define __NO_LOG_INFER__ / __NO_LOG_BOARD__ / __NO_LOG_CONTROLLER__ : drop a category
+// call sites made with log_at() / log_infer_at() then compile to nothing,
+// arguments included; the plain log_xxx() functions skip the formatting only
+#ifndef __LOG_MIN_LEVEL__
+#define __LOG_MIN_LEVEL__ 0
+#endif  // __LOG_MIN_LEVEL__
+
+constexpr bool log_compiled(LogLevel level, LogCategory category=LogCategory::GENERAL) {
+    if (static_cast<size_t>(level) < __LOG_MIN_LEVEL__) { return false; }
+    switch (category) {
+#ifdef __NO_LOG_INFER__
+    case LogCategory::INFER : return false;
+#endif  // __NO_LOG_INFER__
+#ifdef __NO_LOG_BOARD__
+    case LogCategory::BOARD : return false;
+#endif  // __NO_LOG_BOARD__
+#ifdef __NO_LOG_CONTROLLER__
+    case LogCategory::CONTROLLER : return false;
+#endif  // __NO_LOG_CONTROLLER__
+    default: return true;
+    }
+}
+
 
 struct LogMsg {
     time_t time_stamp;
-    // uint32_t pid;
-    // uint64_t tid;
-    std::string msg;
+    long usec = 0;  // sub-second part of time_stamp
+    uint32_t pid = 0;
+    uint64_t tid = 0;  // kernel thread id, as in top -H / gdb
+    std::string_view msg;  // only valid during append()
 };  // endof struct LogMsg
 
+// sub-second timestamps in the log: #define __LOG_SUBSECOND__ -> [2025-03-07 20:57:00.123]
+// thread ids in the log: #define __LOG_THREAD_ID__ -> [INFO]  [tid 1234] ...
+
+/*
+    formatters write into a per-thread buffer and hand back a view of it,
+    valid until the next format() on the same thread; the line comes with
+    its '\n' so an appender writes it in one go
+    the "%Y-%m-%d %H:%M:%S" part only changes once a second, it is kept
+*/
 class LogFormatter {
 public:
-    static std::string format(LogLevel level, const LogMsg& msg) {
-        std::stringstream ss;
-        char buffer[64];
+    static std::string_view format(LogLevel level, const LogMsg& msg) {
+        thread_local std::string buf;
+        buf.clear();
         if (msg.time_stamp == XQ4GB_TIMESTAMP) {
-            strcpy(buffer, "                     \0");
-            //              [2025-03-07 20:57:00]
-            ss << buffer;
+            buf.append(time_width, ' ');
         } else {
-            tm* info = localtime(&msg.time_stamp);
-            strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", info);
-            ss << '[' << buffer << ']';
+            buf += '[';
+            append_time(buf, msg.time_stamp);
+#ifdef __LOG_SUBSECOND__
+            char ms[8];
+            snprintf(ms, sizeof(ms), ".%03ld", msg.usec / 1000);
+            buf += ms;
+#endif  // __LOG_SUBSECOND__
+            buf += ']';
         }
-        ss << LogLevelDescription.at(static_cast<size_t>(level))
-           << ' ' << msg.msg;
-        return ss.str();
+        buf += LogLevelDescription.at(static_cast<size_t>(level));
+        buf += ' ';
+#ifdef __LOG_THREAD_ID__
+        buf += "[tid ";
+        buf += std::to_string(msg.tid);
+        buf += "] ";
+#endif  // __LOG_THREAD_ID__
+        buf += msg.msg;
+        buf += '\n';
+        return buf;
     }
 // private:
     static const std::vector<std::string> LogLevelDescription;
+
+private:
+#ifdef __LOG_SUBSECOND__
+    static constexpr size_t time_width = 25;  // [2025-03-07 20:57:00.123]
+#else  // !__LOG_SUBSECOND__
+    static constexpr size_t time_width = 21;  // [2025-03-07 20:57:00]
+#endif  // __LOG_SUBSECOND__
+    static void append_time(std::string& buf, time_t t) {
+        thread_local time_t cached_t = -1;
+        thread_local char cached[32];
+        thread_local size_t cached_len = 0;
+        if (t != cached_t) {
+            tm info;
+            localtime_r(&t, &info);
+            cached_len = strftime(cached, sizeof(cached), "%Y-%m-%d %H:%M:%S", &info);
+            cached_t = t;
+        }
+        buf.append(cached, cached_len);
+    }
 };  // endof class LogFormatter
 
 class InferFormatter {
     public:
-        static std::string format(LogLevel level, const LogMsg& msg) {
-            // std::stringstream ss;
-            // char buffer[64];
-            // if (msg.time_stamp == XQ4GB_TIMESTAMP) {
-            //     strcpy(buffer, "                     \0");
-            //     //              [2025-03-07 20:57:00]
-            //     ss << buffer;
-            // } else {
-            //     tm* info = localtime(&msg.time_stamp);
-            //     strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", info);
-            //     ss << '[' << buffer << ']';
-            // }
-            // ss << LogLevelDescription.at(static_cast<size_t>(level))
-            //    << ' ' << msg.msg;
-            std::string ret;
-            // ret += '{';
-            ret += std::to_string(msg.time_stamp - XQ4GB_TIMESTAMP);
-            ret += ' ';
-            ret += msg.msg;
-            return ret;
+        static std::string_view format(LogLevel level, const LogMsg& msg) {
+            thread_local std::string buf;
+            buf.clear();
+            char num[24];
+            auto [end, ec] = std::to_chars(num, num + sizeof(num), msg.time_stamp - XQ4GB_TIMESTAMP);
+            buf.append(num, end);
+            buf += ' ';
+            buf += msg.msg;
+            buf += '\n';
+            return buf;
         }
     private:
         static const std::vector<std::string> LogLevelDescription;
@@ -84,6 +149,7 @@ public:
         formatter_(std::make_shared<LogFormatter>()) {}
 
     virtual void append(LogLevel level, const LogMsg& msg) = 0;
+    LogLevel get_level() const { return level_; }
 protected:
     LogLevel level_;
     std::shared_ptr<LogFormatter> formatter_; 
@@ -94,105 +160,170 @@ public:
     StdAppender(LogLevel level) : LogAppender(level) {}
     void append(LogLevel level, const LogMsg& msg) {
         if (level < this->level_) return ;
-        std::string res = this->formatter_->format(level, msg);
-        std::cout << res << "\n";
+        std::string_view res = this->formatter_->format(level, msg);
+        std::cout.write(res.data(), res.size());
     }
 };  // endof class StdAppender
 
+// rotation of ./log and ./inference, see LogFile, define before including anything:
+//   #define __LOG_ROTATE_BYTES__ (16 << 20)  : a new segment past 16MB, 0 for never
+//   #define __LOG_ROTATE_GAMES__ 100  : and/or every 100 games
+//   #define __LOG_ROTATE_SECONDS__ 3600  : and/or every hour
+//   #define __LOG_PREALLOC_BYTES__ 0  : no fallocate
+//   #define __LOG_MMAP__  : append through mmap (apps that don't fork)
+#ifndef __LOG_ROTATE_BYTES__
+#define __LOG_ROTATE_BYTES__ (64UL << 20)
+#endif  // __LOG_ROTATE_BYTES__
+#ifndef __LOG_ROTATE_GAMES__
+#define __LOG_ROTATE_GAMES__ 0
+#endif  // __LOG_ROTATE_GAMES__
+#ifndef __LOG_ROTATE_SECONDS__
+#define __LOG_ROTATE_SECONDS__ 0
+#endif  // __LOG_ROTATE_SECONDS__
+#ifndef __LOG_PREALLOC_BYTES__
+#define __LOG_PREALLOC_BYTES__ (4UL << 20)
+#endif  // __LOG_PREALLOC_BYTES__
+
+inline LogRotation default_log_rotation(bool whole_games) {
+    LogRotation rot;
+    rot.max_bytes = __LOG_ROTATE_BYTES__;
+    rot.max_games = __LOG_ROTATE_GAMES__;
+    rot.max_seconds = __LOG_ROTATE_SECONDS__;
+    rot.prealloc_bytes = __LOG_PREALLOC_BYTES__;
+    rot.whole_games = whole_games;
+#ifdef __LOG_MMAP__
+    rot.use_mmap = true;
+#endif  // __LOG_MMAP__
+    return rot;
+}
+
+// "<dir>/<time info>" for "", else filename without its extension
+inline std::pair<std::string, std::string> log_file_base(const char* dir, std::string filename, 
+                                                         const char* ext) {
+    if (filename != std::string("")) {
+        std::filesystem::path path(filename);
+        std::string e = path.extension().string();
+        filename.resize(filename.size() - e.size());
+        return {filename, e};
+    }
+    std::string str = dir;
+    str += '/'; 
+    append_time_info(str);
+    if (!std::filesystem::exists(dir)) {
+        bool succ = std::filesystem::create_directories(dir);
+        if (!succ) { 
+            std::cerr << "creating dir fails, logfile may be lost\n";
+        }
+    }
+    return {str, ext};
+}
+
 class FileAppender : public LogAppender {
 public:
     static constexpr const char* dir = "./log";
     FileAppender(LogLevel level, std::string filename="") 
-        : LogAppender(level), filename_(filename), fs_() {
-        if (filename == std::string("")) {
-            std::string str = dir;
-            str += '/'; 
-            append_time_info(str);
-            str += ".log";
-            filename_ = str;
-            if (!std::filesystem::exists(dir)) {
-                bool succ = std::filesystem::create_directories(dir);
-                if (!succ) { 
-                    std::cerr << "creating dir fails, logfile may be lost\n";
-                }
-            }
-        }
-        fs_.open(filename_, std::ios::app);
-    }
-    ~FileAppender() {
-        if (fs_.is_open()) {
-            fs_.close();
-        }
-    }
+        : LogAppender(level), 
+          file_(log_file_base(dir, filename, ".log"), default_log_rotation(false)) {}
     void append(LogLevel level, const LogMsg& msg) {
         if (level < this->level_) return ;
-        std::string res = this->formatter_->format(level, msg);
-        if (!fs_.is_open()) {
-            fs_.open(filename_, std::ios::app);
-        }
-        fs_ << res << "\n";
-    }
-    void flush() {
-        if (!fs_.is_open()) {
-            fs_.open(filename_, std::ios::app);
-        }
-        fs_.flush();
+        file_.write(this->formatter_->format(level, msg));
     }
+    void flush() { file_.flush(); }
+    void end_game() { file_.end_game(); }
+    const std::string& get_filename() const { return file_.get_filename(); }
 
 private:
-    std::fstream fs_;
-    std::string filename_;
+    LogFile file_;
 };  // endof class FileAppender
 
 class InferAppender /*: public LogAppender*//*: public FileAppender*/ {  // TODO
 public:
     static constexpr const char* dir = "./inference";
+    // a segment always starts with a game's {h,w} line, logE reads them alone
     InferAppender(LogLevel level, std::string filename="") 
         : level_(level), formatter_(std::make_shared<InferFormatter>()),
-          filename_(filename), fs_() {
-        if (filename == std::string("")) {
-            std::string str = dir;
-            str += '/'; 
-            append_time_info(str);
-            str += ".inf";
-            filename_ = str;
-            if (!std::filesystem::exists(dir)) {
-                bool succ = std::filesystem::create_directories(dir);
-                if (!succ) { 
-                    std::cerr << "Creating dir fails, logfile may be lost\n";
-                }
-            }
-        }
-        fs_.open(filename_, std::ios::app);
-    }
-    ~InferAppender() {
-        if (fs_.is_open()) {
-            fs_.close();
-        }
-    }
+          file_(log_file_base(dir, filename, ".inf"), default_log_rotation(true)) {}
     void append(LogLevel level, const LogMsg& msg) {
         if (level < this->level_) return ;
-        std::string res = this->formatter_->format(level, msg);
-        if (!fs_.is_open()) {
-            fs_.open(filename_, std::ios::app);
-        }
-        fs_ << res << "\n";
-    }
-    void flush() {
-        if (!fs_.is_open()) {
-            fs_.open(filename_, std::ios::app);
-        }
-        fs_.flush();
+        file_.write(this->formatter_->format(level, msg));
     }
+    void flush() { file_.flush(); }
+    void end_game() { file_.end_game(); }
+    const std::string& get_filename() const { return file_.get_filename(); }
+    LogLevel get_level() const { return level_; }
 
 private:
     LogLevel level_;
     std::shared_ptr<InferFormatter> formatter_; 
 
-    std::fstream fs_;
-    std::string filename_;
+    LogFile file_;
 };  // endof class InferAppender
 
+/*
+    one producer thread's lines on their way to the writer:
+    the producer takes this lock alone, the writer only to swap blocks,
+    so threads never wait on each other or on the disk
+*/
+class LogStage {
+public:
+    struct Entry {
+        uint64_t seq;  // Logger-wide, orders the lines of all threads
+        LogLevel level;
+        time_t time_stamp;
+        long usec;
+        uint64_t tid;
+        size_t offset;  // into Block::text
+        size_t len;
+    };  // endof struct Entry
+    struct Block {
+        std::string text;
+        std::vector<Entry> entries;
+        void clear() { text.clear(); entries.clear(); }  // capacity is kept
+    };  // endof struct Block
+
+    // text bytes staged so far
+    size_t push(Entry e, std::string_view msg) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        e.offset = front_.text.size();
+        e.len = msg.size();
+        front_.text.append(msg.data(), msg.size());
+        front_.entries.push_back(e);
+        return front_.text.size();
+    }
+    // writer only: what was staged, valid until the next swap_out()
+    Block& swap_out() {
+        back_.clear();
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::swap(front_, back_);
+        return back_;
+    }
+    // fork: see Logger::before_fork()
+    void lock() { mtx_.lock(); }
+    void unlock() { mtx_.unlock(); }
+    // the child's copy of the parent's lines, under lock()
+    void discard() {
+        front_.clear();
+        back_.clear();
+    }
+
+private:
+    std::mutex mtx_;
+    Block front_, back_;
+};  // endof class LogStage
+
+/*
+    producers (any thread) format into their own buffers and stage the
+    line in their own LogStage; one writer drains all stages, merges the
+    lines by their sequence stamp, i.e. in the order they were logged,
+    and is the only one to touch the appenders
+    the writer is a background thread that wakes every writer_interval
+    or when a stage fills up; WARN and ERROR don't wait for it, they
+    drain everything before them and the appenders write it all to the
+    files at once (no fsync), so a crash or an _exit right after keeps
+    them. end_game() and exit drain the rest
+    fork (match workers): the locks are taken around it, a child starts
+    its own writer on its first line
+*/
 class Logger {
 public:
     static Logger& Instance() {
@@ -200,66 +331,75 @@ public:
         return logger;
     }
 
+    // false if no appender takes `level`, checked before any formatting
+    bool enabled(LogLevel level) const { return level >= min_level_; }
+
     template <typename... Args>
     void log(LogLevel level, const char* fmt, Args&&... args) {
+        if (!enabled(level)) { return ; }
         log(level, format(fmt, std::forward<Args>(args)...));
     }
     template <typename... Args>
     void log(LogLevel level, time_t time_stamp, const char* fmt, Args&&... args) {
+        if (!enabled(level)) { return ; }
         log(level, time_stamp, format(fmt, std::forward<Args>(args)...));
     }
     template <typename... Args>
     void log(LogLevel level, const std::string& fmt, Args&&... args) {
+        if (!enabled(level)) { return ; }
         log(level, format(fmt.c_str(), std::forward<Args>(args)...));
     }
     template <typename... Args>
     void log(LogLevel level, time_t time_stamp, const std::string& fmt, Args&&... args) {
+        if (!enabled(level)) { return ; }
         log(level, time_stamp, format(fmt.c_str(), std::forward<Args>(args)...));
     }
     // check: if we pass a string with const char*, 
     // should it be accepted by the first one?
     void log(LogLevel level, const std::string& msg) {
-        LogMsg lmsg;
-        lmsg.time_stamp = time(0);
-        lmsg.msg = msg;
-        std_appender_.append(level, lmsg);
-        file_appender_.append(level, lmsg);
-#ifdef __LOG_INFERENCE_ELSEWHERE__
-        if (level <= LogLevel::INFER) {
-            inference_appender_.append(level, lmsg);
-        }
-#endif  // __LOG_INFERENCE_ELSEWHERE__
-    } 
-
+        log(level, std::string_view(msg));
+    }
     void log(LogLevel level, time_t time_stamp, const std::string& msg) {
-        LogMsg lmsg;
-        lmsg.time_stamp = time_stamp;
-        lmsg.msg = msg;
-        std_appender_.append(level, lmsg);
-        file_appender_.append(level, lmsg);
+        log(level, time_stamp, std::string_view(msg));
+    }
+    void log(LogLevel level, std::string_view msg) {
+        if (!enabled(level)) { return ; }
+        auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        stage(level, usec / 1000000, usec % 1000000, msg);
+    }
+    void log(LogLevel level, time_t time_stamp, std::string_view msg) {
+        if (!enabled(level)) { return ; }
+        stage(level, time_stamp, 0, msg);
+    }
+    // everything staged so far goes to the appenders
+    void flush() {
+        drain();
+        std::lock_guard<std::mutex> lk(writer_mtx_);
+        file_appender_.flush();
 #ifdef __LOG_INFERENCE_ELSEWHERE__
-        if (level <= LogLevel::INFER) {
-            inference_appender_.append(level, lmsg);
-        }
+        inference_appender_.flush();
 #endif  // __LOG_INFERENCE_ELSEWHERE__
     }
     template <typename... Args>
     void log_infer(size_t infer_depth, const char* fmt, Args&&... args) {
-        log_infer(infer_depth, std::string(fmt), std::forward<Args>(args)...);
+        if (!enabled(LogLevel::INFER)) { return ; }
+        const std::string& fmt_with_pref = form_infer_msg(infer_depth, fmt);
+        log(LogLevel::INFER, fmt_with_pref, INFERENCE_DEPTH - infer_depth, std::forward<Args>(args)...);
     }
     template <typename... Args>
     void log_infer(time_t time_stamp, size_t infer_depth, const char* fmt, Args&&... args) {
-        log_infer(time_stamp, infer_depth, std::string(fmt), std::forward<Args>(args)...);
+        if (!enabled(LogLevel::INFER)) { return ; }
+        const std::string& fmt_with_pref = form_infer_msg(infer_depth, fmt);
+        log(LogLevel::INFER, time_stamp, fmt_with_pref, INFERENCE_DEPTH - infer_depth, std::forward<Args>(args)...);
     }
     template <typename... Args>
     void log_infer(size_t infer_depth, const std::string& fmt, Args&&... args) {
-        std::string fmt_with_pref = form_infer_msg(infer_depth, fmt);
-        log(LogLevel::INFER, fmt_with_pref, INFERENCE_DEPTH - infer_depth, std::forward<Args>(args)...);
+        log_infer(infer_depth, fmt.c_str(), std::forward<Args>(args)...);
     }
     template <typename... Args>
     void log_infer(time_t time_stamp, size_t infer_depth, const std::string& fmt, Args&&... args) {
-        std::string fmt_with_pref = form_infer_msg(infer_depth, fmt);
-        log(LogLevel::INFER, time_stamp, fmt_with_pref, INFERENCE_DEPTH - infer_depth, std::forward<Args>(args)...);
+        log_infer(time_stamp, infer_depth, fmt.c_str(), std::forward<Args>(args)...);
     }
 
     template <typename... Args>
@@ -331,19 +471,36 @@ public:
     }
     // TODO: though harmless, we should keep it behind end_game() in gc 
     void new_game(size_t board_height, size_t board_width) {
-#ifdef __LOG_INFERENCE_ELSEWHERE__
+#if defined(__LOG_INFERENCE_ELSEWHERE__) && !defined(__NO_LOG_INFER__)
         log(LogLevel::INFER, "{%d,%d}", board_height, board_width);
 #endif  // __LOG_INFERENCE_ELSEWHERE__
     }
     void end_game(GameStatus status) {
         log(LogLevel::INFO, "Game ends with status: %s", 
             GameStatusDescription.at(static_cast<size_t>(status)).c_str());
+        drain();
+        std::lock_guard<std::mutex> lk(writer_mtx_);
         file_appender_.flush();
+        file_appender_.end_game();
+#ifdef __LOG_INFERENCE_ELSEWHERE__
+        inference_appender_.flush();
+        inference_appender_.end_game();
+#endif  // __LOG_INFERENCE_ELSEWHERE__
     }
 
 private:
 // #define __CMD_MODE__  // dont need to define CMD_MODE here actually
-#ifdef __CMD_MODE__
+#if defined(__HEADLESS_MODE__)
+    // robot-only runs (match harness) and the game server, keep the disk for warnings
+    Logger() : std_appender_(LogLevel::TOTAL),
+#ifdef __LOG_INFERENCE_ELSEWHERE__
+    file_appender_(LogLevel::WARN),
+    inference_appender_(LogLevel::TOTAL)
+#else  // !__LOG_INFERENCE_ELSEWHERE__
+    file_appender_(LogLevel::WARN)
+#endif  // __LOG_INFERENCE_ELSEWHERE__
+    {}
+#elif defined(__CMD_MODE__)
     Logger() : std_appender_(LogLevel::TOTAL), 
 #ifdef __LOG_INFERENCE_ELSEWHERE__
     file_appender_(LogLevel::DEBUG),
@@ -363,49 +520,177 @@ private:
      {}
 #endif  // __CMD_MODE__
 
+    LogLevel calc_min_level() const {
+        LogLevel ret = std::min(std_appender_.get_level(), file_appender_.get_level());
+#ifdef __LOG_INFERENCE_ELSEWHERE__
+        ret = std::min(ret, inference_appender_.get_level());
+#endif  // __LOG_INFERENCE_ELSEWHERE__
+        return ret;
+    }
     static void infer_log_space(std::string& str, int num) {
         for (int i = 0; i < num; i++) {
             str += "    ";
         }
     }
 
-    ~Logger() {}
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lk(stages_mtx_);
+            stop_ = true;
+        }
+        cv_->notify_all();
+        if (writer_) { writer_->join(); }
+        flush();
+    }
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
-    
-    std::string format(const char* fmt, ...) const {
-        int len;
-        std::string str;
-        va_list args;
-        char buffer[256];
 
+    static constexpr auto writer_interval = std::chrono::milliseconds(50);
+    static constexpr size_t stage_wakeup_bytes = 1 << 16;
+
+    static uint64_t& tid_slot() {
+        thread_local uint64_t tid = 0;
+        return tid;
+    }
+    static uint64_t this_tid() {
+        uint64_t& tid = tid_slot();
+        if (tid == 0) { tid = static_cast<uint64_t>(::syscall(SYS_gettid)); }
+        return tid;
+    }
+    LogStage& this_stage() {
+        thread_local std::shared_ptr<LogStage> st = [this](){
+            auto ret = std::make_shared<LogStage>();
+            std::lock_guard<std::mutex> lk(stages_mtx_);
+            stages_.push_back(ret);
+            return ret;
+        }();
+        return *st;
+    }
+    void start_writer() {
+        std::lock_guard<std::mutex> lk(stages_mtx_);
+        if (writer_running_.load()) { return ; }
+        static bool fork_handlers = (pthread_atfork(&Logger::before_fork, &Logger::after_fork,
+                                                    &Logger::after_fork_child) == 0);
+        (void)fork_handlers;
+        writer_ = std::make_unique<std::thread>(&Logger::write_loop, this);
+        writer_running_.store(true);
+    }
+    // no lock may be held by a thread the child won't have,
+    // and no buffered line may be written twice
+    static void before_fork() {
+        Logger& logger = Instance();
+        logger.drain();  // what's staged goes out once, from the parent
+        logger.writer_mtx_.lock();
+        std::cout.flush();
+        logger.file_appender_.flush();
+#ifdef __LOG_INFERENCE_ELSEWHERE__
+        logger.inference_appender_.flush();
+#endif  // __LOG_INFERENCE_ELSEWHERE__
+        logger.stages_mtx_.lock();
+        for (auto& st : logger.stages_) { st->lock(); }
+    }
+    static void after_fork() {
+        Logger& logger = Instance();
+        for (auto& st : logger.stages_) { st->unlock(); }
+        logger.stages_mtx_.unlock();
+        logger.writer_mtx_.unlock();
+    }
+    static void after_fork_child() {
+        Logger& logger = Instance();
+        // the parent's writer is not a thread here, and it was waiting on cv_
+        (void)logger.writer_.release();
+        (void)logger.cv_.release();
+        logger.cv_ = std::make_unique<std::condition_variable>();
+        logger.writer_running_.store(false);
+        tid_slot() = 0;  // the forking thread, now with the child's id
+        // staged between the drain and the locks: the parent writes them
+        for (auto& st : logger.stages_) { st->discard(); }
+        after_fork();
+    }
+    void stage(LogLevel level, time_t time_stamp, long usec, std::string_view msg) {
+        if (!writer_running_.load(std::memory_order_relaxed)) { start_writer(); }
+        LogStage::Entry e{seq_.fetch_add(1, std::memory_order_relaxed), level, time_stamp, usec, this_tid(), 0, 0};
+        size_t staged = this_stage().push(e, msg);
+        if (level >= LogLevel::WARN) {
+            flush();  // past the appenders' buffers too
+        } else if (staged >= stage_wakeup_bytes) {
+            cv_->notify_one();
+        }
+    }
+    void write_loop() {
+        std::unique_lock<std::mutex> lk(stages_mtx_);
+        while (!stop_) {
+            cv_->wait_for(lk, writer_interval);
+            lk.unlock();
+            drain();
+            lk.lock();
+        }
+    }
+    // the single writer: every stage, merged back into logging order
+    void drain() {
+        std::lock_guard<std::mutex> wlk(writer_mtx_);
+        std::vector<std::shared_ptr<LogStage>> stages;
+        {
+            std::lock_guard<std::mutex> lk(stages_mtx_);
+            // a stage only the registry holds belongs to a finished thread,
+            // it's drained below for the last time
+            stages = stages_;
+            stages_.erase(std::remove_if(stages_.begin(), stages_.end(),
+                [](const std::shared_ptr<LogStage>& st) { return st.use_count() == 2; }), stages_.end());
+        }
+        std::vector<std::pair<const LogStage::Entry*, const LogStage::Block*>> lines;
+        for (auto& st : stages) {
+            const LogStage::Block& block = st->swap_out();
+            for (const LogStage::Entry& e : block.entries) { lines.emplace_back(&e, &block); }
+        }
+        std::sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) {
+            return a.first->seq < b.first->seq;
+        });
+        LogMsg lmsg;
+        lmsg.pid = static_cast<uint32_t>(::getpid());
+        for (auto [e, block] : lines) {
+            lmsg.time_stamp = e->time_stamp;
+            lmsg.usec = e->usec;
+            lmsg.tid = e->tid;
+            lmsg.msg = std::string_view(block->text.data() + e->offset, e->len);
+            append(e->level, lmsg);
+        }
+    }
+    // under writer_mtx_
+    void append(LogLevel level, const LogMsg& lmsg) {
+        std_appender_.append(level, lmsg);
+        file_appender_.append(level, lmsg);
+#ifdef __LOG_INFERENCE_ELSEWHERE__
+        if (level <= LogLevel::INFER) {
+            inference_appender_.append(level, lmsg);
+        }
+#endif  // __LOG_INFERENCE_ELSEWHERE__
+    }
+
+    // into a per-thread buffer, the view is valid until the next format() on this thread
+    std::string_view format(const char* fmt, ...) const {
+        thread_local std::string buf(256, '\0');
+        va_list args, args_again;
         va_start(args, fmt);
-        if ((len = vsnprintf(buffer, sizeof(buffer), fmt, args)) > 0) {
-            if (len < sizeof(buffer)) {
-                str = buffer;
-            } else {
-                int maxsz = len + 1;
-                char* buffer = (char*)malloc(maxsz);
-                if (buffer) {
-                    len = vsnprintf(buffer, maxsz, fmt, args);
-                    if (len > 0 && len < maxsz) {
-                        str = buffer;
-                    }
-                    free(buffer);
-                }
-            }
+        va_copy(args_again, args);
+        int len = vsnprintf(buf.data(), buf.size(), fmt, args);
+        if (len >= static_cast<int>(buf.size())) {
+            buf.resize(len + 1);
+            len = vsnprintf(buf.data(), buf.size(), fmt, args_again);
         }
+        va_end(args_again);
         va_end(args);
-        return str;
+        return len > 0 ? std::string_view(buf.data(), len) : std::string_view();
     }
 
-    std::string form_infer_msg(const size_t infer_depth, const std::string& fmt) const {
+    const std::string& form_infer_msg(const size_t infer_depth, const char* fmt) const {
+        thread_local std::string fmt_with_pref;
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        std::string fmt_with_pref = "[Depth = %d]";
+        fmt_with_pref = "[Depth = %d]";
         infer_log_space(fmt_with_pref, INFERENCE_DEPTH - infer_depth);
         fmt_with_pref += " ::: "; fmt_with_pref += fmt; fmt_with_pref += " ::: ";
 #else  // __LOG_INFERENCE_ELSEWHERE__
-        std::string fmt_with_pref = "%d ";
+        fmt_with_pref = "%d ";
         fmt_with_pref += fmt;
         #endif  // __LOG_INFERENCE_ELSEWHERE__
         return fmt_with_pref;
@@ -415,70 +700,92 @@ private:
 #ifdef __LOG_INFERENCE_ELSEWHERE__
     InferAppender inference_appender_;
 #endif  // __LOG_INFERENCE_ELSEWHERE__
+    const LogLevel min_level_ = calc_min_level();  // after the appenders
+
+    std::atomic<uint64_t> seq_{0};
+    std::mutex stages_mtx_;  // stages_, stop_, writer_ start
+    std::vector<std::shared_ptr<LogStage>> stages_;
+    std::mutex writer_mtx_;  // the appenders, and who drains
+    std::unique_ptr<std::condition_variable> cv_ = std::make_unique<std::condition_variable>();
+    std::unique_ptr<std::thread> writer_;
+    std::atomic<bool> writer_running_{false};
+    bool stop_ = false;
 };  // endof class Logger
 
 template <typename... Args>
 void log(LogLevel level, const char* fmt, Args&&... args) {
+    if (!log_compiled(level)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log(level, fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log(LogLevel level, time_t time_stamp, const char* fmt, Args&&... args) {
+    if (!log_compiled(level)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log(level, time_stamp, fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void log_infer(size_t infer_depth, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::INFER, LogCategory::INFER)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_infer(infer_depth, fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log_infer(time_t time_stamp, size_t infer_depth, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::INFER, LogCategory::INFER)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_infer(time_stamp, infer_depth, fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void log_debug(const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::DEBUG)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_debug(fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log_debug(time_t time_stamp, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::DEBUG)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_debug(time_stamp, fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void log_info(const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::INFO)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_info(fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log_info(time_t time_stamp, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::INFO)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_info(time_stamp, fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void log_warn(const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::WARN)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_warn(fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log_warn(time_t time_stamp, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::WARN)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_warn(time_stamp, fmt, std::forward<Args>(args)...);
 }
 
 template <typename... Args>
 void log_error(const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::ERROR)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_error(fmt, std::forward<Args>(args)...);
 }
 template <typename... Args>
 void log_error(time_t time_stamp, const char* fmt, Args&&... args) {
+    if constexpr (!log_compiled(LogLevel::ERROR)) { return ; }
     Logger& logger = Logger::Instance();
     logger.log_error(time_stamp, fmt, std::forward<Args>(args)...);
 }
@@ -492,6 +799,27 @@ void log_end_game(GameStatus status) {
     logger.end_game(status);
 }
 
+// call sites in hot paths: nothing is evaluated if the level or the category
+// is compiled out, a level compare is all if no appender takes it
+#define log_at(category, level, ...) do {  \
+    if constexpr (::mfwu::log_compiled(::mfwu::LogLevel::level, ::mfwu::LogCategory::category)) {  \
+        if (::mfwu::Logger::Instance().enabled(::mfwu::LogLevel::level)) {  \
+            ::mfwu::log(::mfwu::LogLevel::level, __VA_ARGS__);  \
+        }  \
+    }  \
+} while (0)
+#define log_infer_at(...) do {  \
+    if constexpr (::mfwu::log_compiled(::mfwu::LogLevel::INFER, ::mfwu::LogCategory::INFER)) {  \
+        if (::mfwu::Logger::Instance().enabled(::mfwu::LogLevel::INFER)) {  \
+            ::mfwu::log_infer(__VA_ARGS__);  \
+        }  \
+    }  \
+} while (0)
+// guard for work that is only done to be logged
+#define log_on(category, level)  \
+    (::mfwu::log_compiled(::mfwu::LogLevel::level, ::mfwu::LogCategory::category)  \
+     && ::mfwu::Logger::Instance().enabled(::mfwu::LogLevel::level))
+
 
 // ---------------------------------------------
 // logerr shortcuts
@@ -16,6 +16,13 @@ public:
         : board_(board), player_color_(color) {}
 
     virtual CommandType play() = 0;
+    // this turn's command, from the board or posted to the game controller
+    // robots take none
+    virtual CommandType play(const Command& /*cmd*/) { return play(); }
+    virtual bool needs_input() const { return false; }
+    // the move only, nothing placed: robots search here off the game loop,
+    // and the result comes back through play(cmd)
+    virtual Position think() const { return {}; }
 
     virtual void place(const Position& pos) {
         place(Piece(pos, this->player_color_));
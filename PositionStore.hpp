@@ -0,0 +1,236 @@
+#ifndef __POSITIONSTORE_HPP__
+#define __POSITIONSTORE_HPP__
+
+#include "common.hpp"
+#include "ArchiveReader.hpp"
+#include "BoardHash.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace mfwu {
+
+/*
+    on-disk position table, every position of every archived game
+    under its canonical hash (min over the 8 symmetries), little endian
+
+        header (32 bytes): char[4] "GBPS", u16 version, u16 board size,
+                           u64 capacity (power of 2), u64 entries, u64 games
+        table: capacity * Entry, open addressing with linear probing,
+               key 0 marks an empty slot
+
+    the file is mmap'd, a lookup touches one or two pages
+    and the table grows (doubles) in place at 70% load
+*/
+class PositionStore {
+public:
+    struct Entry {
+        uint64_t key;
+        uint32_t visits;      // abandoned games count here only
+        uint32_t black_wins;
+        uint32_t white_wins;
+        uint32_t draws;
+    };  // endof struct Entry
+    static_assert(sizeof(Entry) == 24);
+
+    static constexpr const char file_magic[4] = {'G', 'B', 'P', 'S'};
+    static constexpr uint16_t version = 1;
+    static constexpr size_t header_len = 32;
+    static constexpr size_t min_capacity = 1UL << 12;
+
+    // read_only: query only, the file must exist
+    // otherwise the file is created if missing, truncate drops what's in it
+    PositionStore(const std::string& filename, size_t size,
+                  bool read_only=false, bool truncate=false)
+        : filename_(filename), size_(size), read_only_(read_only) {
+        int flags = read_only_ ? O_RDONLY : O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+        fd_ = ::open(filename_.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            std::cerr << "position store: cannot open " << filename_ << "\n";
+            return ;
+        }
+        struct stat st;
+        ::fstat(fd_, &st);
+        if (st.st_size == 0 && !read_only_) {
+            if (size_ == 0 || size_ > BoardHash::max_size) {
+                std::cerr << "position store: bad board size for " << filename_ << "\n";
+                return ;
+            }
+            status_ = map(min_capacity, true);
+            return ;
+        }
+        char header[header_len];
+        if (::pread(fd_, header, header_len, 0) != static_cast<ssize_t>(header_len)
+            || memcmp(header, file_magic, 4) != 0
+            || get<uint16_t>(header + 4) != version) {
+            std::cerr << "position store: " << filename_ << " is not a position store\n";
+            return ;
+        }
+        size_t file_size = get<uint16_t>(header + 6);
+        if (size_ == 0) { size_ = file_size; }
+        if (file_size != size_) {
+            std::cerr << "position store: " << filename_ << " holds "
+                      << file_size << "x" << file_size << " boards\n";
+            return ;
+        }
+        size_t capacity = get<uint64_t>(header + 8);
+        if (capacity == 0 || (capacity & (capacity - 1))
+            || static_cast<size_t>(st.st_size) < header_len + capacity * sizeof(Entry)) {
+            std::cerr << "position store: " << filename_ << " is truncated\n";
+            return ;
+        }
+        status_ = map(capacity, false);
+    }
+    ~PositionStore() {
+        unmap();
+        if (fd_ >= 0) { ::close(fd_); }
+    }
+    PositionStore(const PositionStore&) = delete;
+    PositionStore& operator=(const PositionStore&) = delete;
+
+    bool get_status() const { return status_; }
+    size_t get_size() const { return size_; }
+    size_t get_capacity() const { return capacity_; }
+    size_t get_entries() const { return status_ ? get<uint64_t>(base_ + 16) : 0; }
+    size_t get_games() const { return status_ ? get<uint64_t>(base_ + 24) : 0; }
+
+    // every position of the game, the empty board included,
+    // false if it's not for this store (size) or the store is read only
+    bool add_game(const ArchiveGame& game) {
+        if (!status_ || read_only_ || game.size != size_) { return false; }
+        std::optional<Piece::Color> res = game.result();
+        std::vector<uint8_t> board(size_ * size_, 0);  // real statuses
+        for (size_t ply = 0; ; ply++) {
+            Entry* e = find_or_insert(BoardHash::canonical_hash(board, size_));
+            if (e == nullptr) { return false; }
+            e->visits++;
+            if (res.has_value()) {
+                if (*res == Piece::Color::Black) { e->black_wins++; }
+                else if (*res == Piece::Color::White) { e->white_wins++; }
+                else { e->draws++; }
+            }
+            if (ply == game.moves.size()) { break; }
+            PackedMove mv = game.moves[ply];
+            board[mv.row() * size_ + mv.col()] = mv.get_real_status();
+        }
+        set<uint64_t>(base_ + 24, get_games() + 1);
+        return true;
+    }
+    // board: size * size statuses in row-major order,
+    // nullptr if the position never showed up
+    template <typename Cell_t>
+    const Entry* lookup(const std::vector<Cell_t>& board) const {
+        return lookup_key(BoardHash::canonical_hash(board, size_));
+    }
+    const Entry* lookup_key(uint64_t hash) const {
+        if (!status_) { return nullptr; }
+        uint64_t key = to_key(hash);
+        for (size_t i = key & (capacity_ - 1); ; i = (i + 1) & (capacity_ - 1)) {
+            const Entry& e = table_[i];
+            if (e.key == key) { return &e; }
+            if (e.key == 0) { return nullptr; }
+        }
+    }
+    void sync() {
+        if (status_ && !read_only_) { ::msync(base_, mapped_bytes_, MS_SYNC); }
+    }
+
+private:
+    // the canonical hash of the empty board is 0, move it off the empty mark
+    static uint64_t to_key(uint64_t hash) {
+        return hash ? hash : BoardHash::side_key();
+    }
+    Entry* find_or_insert(uint64_t hash) {
+        if ((get_entries() + 1) * 10 > capacity_ * 7 && !grow()) { return nullptr; }
+        uint64_t key = to_key(hash);
+        for (size_t i = key & (capacity_ - 1); ; i = (i + 1) & (capacity_ - 1)) {
+            Entry& e = table_[i];
+            if (e.key == key) { return &e; }
+            if (e.key == 0) {
+                e.key = key;
+                set<uint64_t>(base_ + 16, get_entries() + 1);
+                return &e;
+            }
+        }
+    }
+    // doubles the table and rehashes every entry into it
+    bool grow() {
+        std::vector<Entry> old;
+        old.reserve(get_entries());
+        for (size_t i = 0; i < capacity_; i++) {
+            if (table_[i].key) { old.push_back(table_[i]); }
+        }
+        size_t games = get_games();
+        size_t capacity = capacity_ * 2;
+        unmap();
+        if (!map(capacity, true)) {
+            status_ = false;
+            return false;
+        }
+        for (const Entry& e : old) {
+            size_t i = e.key & (capacity_ - 1);
+            while (table_[i].key) { i = (i + 1) & (capacity_ - 1); }
+            table_[i] = e;
+        }
+        set<uint64_t>(base_ + 16, old.size());
+        set<uint64_t>(base_ + 24, games);
+        return true;
+    }
+    // init: size the file for `capacity` and write an empty table
+    bool map(size_t capacity, bool init) {
+        size_t bytes = header_len + capacity * sizeof(Entry);
+        if (init && ::ftruncate(fd_, bytes) != 0) {
+            std::cerr << "position store: cannot resize " << filename_ << "\n";
+            return false;
+        }
+        void* p = ::mmap(nullptr, bytes, read_only_ ? PROT_READ : PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            std::cerr << "position store: cannot mmap " << filename_ << "\n";
+            return false;
+        }
+        base_ = static_cast<char*>(p);
+        mapped_bytes_ = bytes;
+        capacity_ = capacity;
+        table_ = reinterpret_cast<Entry*>(base_ + header_len);
+        if (init) {
+            memset(base_, 0, bytes);
+            memcpy(base_, file_magic, 4);
+            set<uint16_t>(base_ + 4, version);
+            set<uint16_t>(base_ + 6, static_cast<uint16_t>(size_));
+            set<uint64_t>(base_ + 8, capacity_);
+        }
+        return true;
+    }
+    void unmap() {
+        if (base_ == nullptr) { return ; }
+        ::munmap(base_, mapped_bytes_);
+        base_ = nullptr;
+        table_ = nullptr;
+    }
+    template <typename T>
+    static T get(const char* p) {
+        T val;
+        memcpy(&val, p, sizeof(T));
+        return val;
+    }
+    template <typename T>
+    static void set(char* p, T val) {
+        memcpy(p, &val, sizeof(T));
+    }
+
+    std::string filename_;
+    size_t size_;
+    bool read_only_;
+    int fd_ = -1;
+    char* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    size_t capacity_ = 0;
+    Entry* table_ = nullptr;
+    bool status_ = false;
+};  // endof class PositionStore
+
+}  // endof namespace mfwu
+
+#endif  // __POSITIONSTORE_HPP__
@@ -2,6 +2,7 @@
 #define __ROBOTPLAYER_HPP__
 
 #include "Player.hpp"
+#include "BoardHash.hpp"
 
 namespace mfwu {
 
@@ -13,48 +14,116 @@ namespace mfwu {
     3. tell the differences between uniformed ChessBoard and user-defined robot strategies
 */
 // X-Q41 25.04.14
+// (the vvs is a flat array by now, see DeductionBoard)
 class DeductionBoard_base {
 public:
-    DeductionBoard_base() = delete;
-    DeductionBoard_base(const std::vector<std::vector<size_t>>& board) 
-        : board_(board) { assert(board.size() > 0 && board.size() == board[0].size()); }
-    DeductionBoard_base(std::vector<std::vector<size_t>>&& board) 
-        : board_(std::move(board)) { assert(board_.size() > 0 && board_.size() == board_[0].size()); }
-
-    std::vector<size_t>& operator[](int idx) {
-        return board_[idx];
-    }
+    // status at [row, col], as the vvs had it
+    virtual size_t at(int row, int col) const = 0;
+    virtual std::vector<std::vector<size_t>> snap() const = 0;
+    // zobrist hash of the stones, kept up to date by deduce_*
+    uint64_t get_hash() const { return hash_; }
     virtual size_t size() const = 0;
-    virtual void deduce_new_piece(const Piece& p, int depth) = 0;  // TODO: depth as arg[0]
-    virtual void deduce_reset_pos(const Position& p) = 0;
+    virtual void deduce_new_piece(PackedMove mv, int depth) = 0;  // TODO: depth as arg[0]
+    virtual void deduce_reset_pos(PackedMove mv) = 0;
+    virtual void deduce_reset_pos(std::initializer_list<PackedMove> mvs) = 0;  // no heap per call
     virtual float calc_pos(int row, int col, Piece::Color color) const = 0;
     // pure specifier is "= 0", not "=0", LOL
+    // the empty cells worth a look, row-major
+    // false: no such list, every empty cell is (the full boards)
+    virtual bool candidates(std::vector<PackedMove>&) const { return false; }
 
 protected:
-    std::vector<std::vector<size_t>> board_;
+    uint64_t hash_ = 0;
 };  // endof class DeductionBoard_base
 
-template <BoardSize Size=BoardSize::Small>
+/*
+    one byte a cell in a single array, row after row, with a ring of
+    border cells around the board: (N + 2) ^ 2 bytes, 729 for 25x25
+    a border cell matches no color and isn't empty, so a walk in any
+    direction stops on it just like it stopped on is_valid_pos before,
+    and search_one_dir needs no bounds checks
+    Side: the board side as a constant, for the sizes played most;
+    0 takes it from the board at run time (any engine size), the array is
+    then as large as the largest board
+*/
+template <size_t Side=0>
 class DeductionBoard : public DeductionBoard_base {
 public:
-    using base_type = DeductionBoard_base;   
+    using base_type = DeductionBoard_base;
+    static constexpr size_t cells_len = Side ? (Side + 2) * (Side + 2) 
+                                             : (max_board_size + 2) * (max_board_size + 2);
+    static constexpr uint8_t border = 0xFF;
 
     DeductionBoard() = delete;
-    DeductionBoard(const std::vector<std::vector<size_t>>& board) 
-        : base_type(board), board_log_(board) {}
-    DeductionBoard(std::vector<std::vector<size_t>>&& board)
-        : base_type(std::move(board)), board_log_(this->board_) {}
+    // from ChessBoard::snap()
+    DeductionBoard(const std::vector<std::vector<size_t>>& board)
+        : side_(static_cast<int>(board.size())), board_log_(board) {
+        assert(Side ? board.size() == Side : is_valid_board_size(board.size()));
+        assert(board[0].size() == board.size());
+        cells_.fill(border);
+        for (int row = 0; row < side(); row++) {
+            for (int col = 0; col < side(); col++) {
+                cells_[idx(row, col)] = static_cast<uint8_t>(board[row][col]);
+                toggle_hash(row, col);
+            }
+        }
+    }
 
-    size_t size() const override { return static_cast<size_t>(Size); }
-    void deduce_new_piece(const Piece& p, int depth) override {
-        size_t real_status = Piece::get_real_status(p.color);
-        this->board_[p.row][p.col] = real_status + 1;
-        board_log_.update(p.row, p.col, real_status + 1);
-        board_log_.log_inference(depth, board_);  // TODO: i thick board_log can use its own framework
+    // from the stones alone, cells out of [lo, hi) are border too:
+    // a window on a larger board, see WindowDeductionBoard
+    // the log board is only the window's size if inference is logged at all
+    DeductionBoard(size_t side, const std::vector<PackedMove>& stones, Position lo, Position hi)
+        : side_(static_cast<int>(side)), board_log_(log_on(INFER, INFER) ? side : min_board_size) {
+        assert(Side ? side == Side : is_valid_board_size(side));
+        cells_.fill(border);
+        for (int row = std::max(lo.row, 0); row < std::min(hi.row, side_); row++) {
+            for (int col = std::max(lo.col, 0); col < std::min(hi.col, side_); col++) {
+                cells_[idx(row, col)] = 0;
+            }
+        }
+        for (PackedMove mv : stones) {
+            cells_[idx(mv.row(), mv.col())] = static_cast<uint8_t>(mv.get_real_status());
+            toggle_hash(mv.row(), mv.col());
+        }
+        if (!log_on(INFER, INFER)) { return ; }
+        for (PackedMove mv : stones) { board_log_.update(mv.row(), mv.col(), mv.get_real_status()); }
+    }
+
+    size_t size() const override { return static_cast<size_t>(side()); }
+    size_t at(int row, int col) const override { return cells_[idx(row, col)]; }
+    std::vector<std::vector<size_t>> snap() const override {
+        std::vector<std::vector<size_t>> res(side(), std::vector<size_t>(side()));
+        for (int row = 0; row < side(); row++) {
+            for (int col = 0; col < side(); col++) { res[row][col] = at(row, col); }
+        }
+        return res;
+    }
+    void deduce_new_piece(PackedMove mv, int depth) override {
+        int row = mv.row(), col = mv.col();
+        size_t real_status = mv.get_real_status();
+        cells_[idx(row, col)] = static_cast<uint8_t>(real_status + 1);
+        toggle_hash(row, col);
+        if (!log_on(INFER, INFER)) { return ; }  // the log board is all that's left
+        board_log_.update(row, col, real_status + 1);
+        board_log_.log_inference(depth, *this);  // TODO: i thick board_log can use its own framework
     }
-    void deduce_reset_pos(const Position& p) override {
-        this->board_[p.row][p.col] = 0;
-        board_log_.update(p.row, p.col, 0);
+    void deduce_reset_pos(PackedMove mv) override {
+        toggle_hash(mv.row(), mv.col());
+        cells_[idx(mv.row(), mv.col())] = 0;
+        if (log_on(INFER, INFER)) { board_log_.update(mv.row(), mv.col(), 0); }
+    }
+    void deduce_reset_pos(std::initializer_list<PackedMove> mvs) override {
+        for (PackedMove mv : mvs) {
+            toggle_hash(mv.row(), mv.col());
+            cells_[idx(mv.row(), mv.col())] = 0;
+        }
+        if (!log_on(INFER, INFER)) { return ; }
+        std::vector<Piece> cells;
+        cells.reserve(mvs.size());
+        for (PackedMove mv : mvs) {
+            cells.emplace_back(mv.row(), mv.col(), Piece::Color::Invalid);
+        }
+        board_log_.update(cells);
     }
 
     // NOTE: why not setting 'Piece' as the input arg?
@@ -63,10 +132,9 @@ public:
     // 得保留一些原有的味道，不然你都不知道我是从💩山挪过来的
     // 25.04.08 XQ3
     float calc_pos(int row, int col, Piece::Color color) const override {
-        std::vector<int> res;
-        res.reserve(4);
-        for (auto&& [inc_r, inc_c] : half_dirs) {
-            res.emplace_back(search_dir_rank(row, col, inc_r, inc_c, color));
+        std::array<int, 4> res;
+        for (size_t i = 0; i < res.size(); i++) {
+            res[i] = search_dir_rank(row, col, half_dirs[i].first, half_dirs[i].second, color);
         }
         std::sort(res.begin(), res.end());
 
@@ -77,10 +145,19 @@ public:
         return 0.8 * score_map[res[0]] + 0.2 * score_map[res[1]];
     }
 
-private:
-    bool is_valid_pos(int row, int col) const {
-        return row >= 0 && row < this->size()
-               && col >= 0 && col < this->size();
+protected:
+    int side() const {
+        if constexpr (Side != 0) { return static_cast<int>(Side); }
+        else { return side_; }
+    }
+    int stride() const { return side() + 2; }
+    int idx(int row, int col) const {
+        return (row + 1) * stride() + col + 1;
+    }
+    // call before clearing a cell and after filling it
+    void toggle_hash(int row, int col) {
+        size_t status = cells_[idx(row, col)];
+        if (status) { hash_ ^= BoardHash::key(row, col, Piece::get_real_status(status)); }
     }
     int search_dir_rank(int row, int col, int inc_r, int inc_c, Piece::Color color) const {
         // assert(this->board_[row][col] == 0);
@@ -121,49 +198,119 @@ private:
     }
     void search_one_dir(int row, int col, int inc_r, int inc_c, 
                         int& seq, int& emp, int& jump, Piece::Color color) const {
-        // size_t sz = this->board_->size();
+        const int inc = inc_r * stride() + inc_c;
+        const size_t real_color = Piece::get_real_status(color);
+        int cur = idx(row, col);
         for (int step = 1; step < 5; step++) {
-            int cur_r = row + step * inc_r;
-            int cur_c = col + step * inc_c;
-            if (!is_valid_pos(cur_r, cur_c)) { break; }
-            if (this->board_[cur_r][cur_c] == 0) {
+            cur += inc;
+            size_t status = cells_[cur];
+            if (status == 0) {
                 emp++;
                 for (int inc_step = 1; inc_step < 5; inc_step++) {
-                    cur_r = row + (step + inc_step) * inc_r;
-                    cur_c = col + (step + inc_step) * inc_c;
-                    if (!is_valid_pos(cur_r, cur_c)) { break; }
-                    if (Piece::get_real_status(this->board_[cur_r][cur_c])
-                        == Piece::get_real_status(color)) {
+                    cur += inc;
+                    if (Piece::get_real_status(cells_[cur]) == real_color) {
                         jump++;
-                    } else { break; }
+                    } else { break; }  // the border too
                 }
                 break;
-            } else if (Piece::get_real_status(this->board_[cur_r][cur_c])
-                       == Piece::get_real_status(color)) {
+            } else if (Piece::get_real_status(status) == real_color) {
                 seq++;
             } else {
-                break;
+                break;  // the border too
             }
         }
     }
 
-    InferDisplayer<Size> board_log_;
+    int side_;  // what side() says when Side is 0
+    std::array<uint8_t, cells_len> cells_;
+    InferDisplayer<BoardSize::Dynamic> board_log_;  // one displayer for every size
 };  // endof class DeductionBoard
 
+/*
+    the search on a SparseBoard: a PackedMove::max_side square cut out of
+    it (the moves must pack), and candidates around the stones only, so a
+    node costs in stones, not in window area
+    the stones are kept in a list, the candidates are their radius
+    neighbours, deduplicated by an epoch stamp per cell
+*/
+class WindowDeductionBoard : public DeductionBoard<PackedMove::max_side> {
+public:
+    using base_type = DeductionBoard<PackedMove::max_side>;
+    static constexpr int window_side = PackedMove::max_side;
+    static constexpr int radius = 2;
+
+    // stones in window coordinates, [lo, hi): the part of the window on the board
+    WindowDeductionBoard(const std::vector<PackedMove>& stones, Position lo, Position hi)
+        : base_type(window_side, stones, lo, hi), stones_(stones) {
+        mark_.fill(0);
+    }
+
+    void deduce_new_piece(PackedMove mv, int depth) override {
+        base_type::deduce_new_piece(mv, depth);
+        stones_.push_back(mv);
+    }
+    void deduce_reset_pos(PackedMove mv) override {
+        base_type::deduce_reset_pos(mv);
+        forget(mv);
+    }
+    void deduce_reset_pos(std::initializer_list<PackedMove> mvs) override {
+        base_type::deduce_reset_pos(mvs);
+        for (PackedMove mv : mvs) { forget(mv); }
+    }
+    bool candidates(std::vector<PackedMove>& out) const override {
+        out.clear();
+        if (++epoch_ == 0) {  // wrapped, old stamps could match again
+            mark_.fill(0);
+            epoch_ = 1;
+        }
+        for (PackedMove st : stones_) {
+            for (int row = st.row() - radius; row <= st.row() + radius; row++) {
+                if (row < 0 || row >= window_side) { continue; }
+                for (int col = st.col() - radius; col <= st.col() + radius; col++) {
+                    if (col < 0 || col >= window_side) { continue; }
+                    int i = idx(row, col);
+                    if (cells_[i] != 0 || mark_[i] == epoch_) { continue; }  // the border isn't 0 either
+                    mark_[i] = epoch_;
+                    out.emplace_back(row, col);
+                }
+            }
+        }
+        // same colorless code everywhere: the bits sort row-major
+        std::sort(out.begin(), out.end(), [](PackedMove a, PackedMove b) { return a.bits < b.bits; });
+        return true;
+    }
+
+private:
+    // resets undo the latest moves, found from the back
+    void forget(PackedMove mv) {
+        for (size_t i = stones_.size(); i-- > 0; ) {
+            if (stones_[i] == mv) {
+                stones_.erase(stones_.begin() + i);
+                return ;
+            }
+        }
+    }
+
+    std::vector<PackedMove> stones_;  // window coordinates
+    mutable std::array<uint32_t, cells_len> mark_;
+    mutable uint32_t epoch_ = 0;
+};  // endof class WindowDeductionBoard
+
 class RobotPlayer : public Player {
 public:
     RobotPlayer() : Player() {}
     RobotPlayer(std::shared_ptr<ChessBoard_base> board, Piece::Color color) : Player(board, color) {}
 
     virtual CommandType play() override {
-        Position pos = this->get_best_position();
-        if (pos.row < 0 || pos.col < 0) {
-            log_info("Robot's pos: [%d, %d], an ending may have been met");
-            return CommandType::INVALID;
-        } // else
-        log_info("Robot's pos: [%d, %d]", pos.row, pos.col);
-        this->place(pos);
-        return CommandType::PIECE;
+        return play_at(this->get_best_position());
+    }
+    // a PIECE here is the move think() found
+    CommandType play(const Command& cmd) override {
+        if (cmd.type != CommandType::PIECE) { return play(); }
+        return play_at(cmd.pos);
+    }
+    Position think() const override {
+        return this->get_best_position();
     }
 
     void place(const Position& pos) override {
@@ -172,6 +319,17 @@ public:
 
 protected:
     virtual Position get_best_position() const = 0;
+
+private:
+    CommandType play_at(const Position& pos) {
+        if (pos.row < 0 || pos.col < 0) {
+            log_info("Robot's pos: [%d, %d], an ending may have been met", pos.row, pos.col);
+            return CommandType::INVALID;
+        } // else
+        log_info("Robot's pos: [%d, %d]", pos.row, pos.col);
+        this->place(pos);
+        return CommandType::PIECE;
+    }
 };  // endof class RobotPlayer
 
 class DebugRobot : public RobotPlayer {
@@ -180,6 +338,12 @@ public:
     DebugRobot(std::shared_ptr<ChessBoard_base> board, Piece::Color color) : RobotPlayer(board, color) {}
 private:
     Position get_best_position() const override {
+        if (this->board_->is_sparse()) {  // no size to draw from, any spot near a stone
+            std::vector<Position> cands = this->board_->candidates();
+            if (cands.empty()) { return this->board_->center(); }
+            sleep(1);
+            return cands[rand() % cands.size()];
+        }
         size_t len = this->board_->size();
         int row = -1, col = -1;
         while (is_valid(row, col) == false) {
@@ -206,6 +370,7 @@ public:
     ~DummyRobot() {}
 private:
     Position get_best_position() const override {
+        if (this->board_->is_sparse()) { return get_best_sparse(); }
         int row = -1, col = -1;
         float hi_score = -1;
         size_t sz = this->board_->size();
@@ -227,6 +392,21 @@ private:
         return {(int)sz / 2, (int)sz / 2};
         return {row, col};
     }
+    // same scores, only the cells next to a stone
+    Position get_best_sparse() const {
+        std::vector<Position> cands = this->board_->candidates();
+        if (cands.empty()) { return this->board_->center(); }
+        Position best;
+        float hi_score = -1;
+        for (const Position& pos : cands) {
+            float score = calc_pos(pos.row, pos.col);
+            if (score > hi_score) {
+                best = pos;
+                hi_score = score;
+            }
+        }
+        return best;
+    }
 
     float calc_pos(int row, int col) const {
         count_res_4 cnt;
@@ -272,13 +452,88 @@ private:
     // mutable std::vector<std::vector<float>> scores_;
 };  // endof class DummyRobot
 
+// knobs of HumanLikeRobot, defaults are what we play with
+// the match harness (match.cc) pits two of them against each other
+struct HumanLikeConfig {
+    int depth = INFERENCE_DEPTH;
+    float op_weight = 0.6F;    // how much blocking the opponent is worth
+    float next_weight = 0.2F;  // how much the follow-up after the reply is worth
+    int choices = 3;           // candidates at depth 0, one more per depth
+};  // endof struct HumanLikeConfig
+
+// one root candidate of a multi-line analysis
+struct SearchLine {
+    float score = 0;
+    std::vector<PackedMove> moves;  // the candidate, then the replies the search expects
+};  // endof struct SearchLine
+
 class HumanLikeRobot : public RobotPlayer {
 public:
+    using clock_type = std::chrono::steady_clock;
+
     HumanLikeRobot() : RobotPlayer() {}
     HumanLikeRobot(std::shared_ptr<ChessBoard_base> board, Piece::Color color) : RobotPlayer(board, color) {}
+    HumanLikeRobot(std::shared_ptr<ChessBoard_base> board, Piece::Color color,
+                   const HumanLikeConfig& config) : RobotPlayer(board, color), config_(config) {}
     ~HumanLikeRobot() {}
+
+    void set_config(const HumanLikeConfig& config) { config_ = config; }
+    const HumanLikeConfig& get_config() const { return config_; }
+    // time-limited play (engine front ends): iterative deepening up to
+    // config_.depth, a depth that runs out of time is thrown away
+    // nullopt: the plain fixed-depth search
+    void set_deadline(std::optional<clock_type::time_point> deadline) { deadline_ = deadline; }
+    int get_last_depth() const { return last_depth_; }
+    // ties are broken with this robot's own generator from here on instead of
+    // the global rand(), for searches side by side on threads (Analyzer)
+    void set_seed(uint32_t seed) { rng_.emplace(seed); }
+
+    // offline analysis, no live board: the fixed-depth answer for `color` on `board`
+    // heatmap (optional): the root score of every empty cell,
+    // the searched candidates with their deeper score
+    // lines (optional): multi-pv, the best `num_lines` root candidates with
+    // the line behind each, best first, out of the same single search
+    std::tuple<float, int, int> analyze(std::vector<std::vector<size_t>> board, Piece::Color color,
+                                        std::vector<std::vector<float>>* heatmap=nullptr,
+                                        std::vector<SearchLine>* lines=nullptr, size_t num_lines=0) const {
+        size_t sz = board.size();
+        bool is_clear_flag = std::all_of(board.begin(), board.end(), [](const std::vector<size_t>& line) {
+            return std::all_of(line.begin(), line.end(), [](size_t s) { return s == 0; });
+        });
+        if (lines) { lines->clear(); }
+        if (!make_deduction_board(std::move(board))) { return {0, -1, -1}; }
+        last_depth_ = config_.depth;
+        if (is_clear_flag) {  // as in the game, whatever the heatmap says
+            if (heatmap) { heatmap->assign(sz, std::vector<float>(sz, 0.0F)); }
+            if (lines && num_lines) { lines->push_back({0, {PackedMove{(int)sz / 2, (int)sz / 2, color}}}); }
+            return {0, (int)sz / 2, (int)sz / 2};
+        }
+        RootReport report;
+        report.min_choices = lines ? num_lines : 0;
+        report.heatmap = heatmap;
+        log_infer_root(config_.depth, color);
+        auto ret = get_best(config_.depth, color, &report);
+        if (lines && num_lines) {
+            auto& searched = report.searched;
+            // the chosen move first, ties included
+            auto it = std::find_if(searched.begin(), searched.end(), [&ret](const std::tuple<float, int, int>& t) {
+                return std::get<1>(t) == std::get<1>(ret) && std::get<2>(t) == std::get<2>(ret);
+            });
+            if (it != searched.end()) { std::iter_swap(searched.begin(), it); }
+            if (searched.size() > 1) {
+                std::stable_sort(searched.begin() + 1, searched.end(), cmp{});
+            }
+            for (size_t i = 0; i < std::min(num_lines, searched.size()); i++) {
+                auto [score, row, col] = searched[i];
+                lines->push_back({score, get_line(config_.depth, color, row, col)});
+            }
+        }
+        release_cache();
+        return ret;
+    }
 private:
     Position get_best_position() const override {
+        if (this->board_->is_sparse()) { return get_best_sparse(); }
         size_t sz = this->board_->size();
         
         bool is_clear_flag = true; // TODO: board_->is_clear
@@ -297,95 +552,266 @@ private:
         // then move this part to constructor and rm mutable qualifier
         // however, deduction_board_ should not detect the changes of board_
         // so, i wont implement it here X 25.04.08
-        switch (this->board_->size()) {
+        make_deduction_board(this->board_->snap());
+        return search();
+    }
+    // on deduction_board_, fixed depth or against the deadline
+    Position search() const {
+        if (!deadline_.has_value()) {
+            log_infer_root(config_.depth, this->player_color_);
+            auto [_, best_row, best_col] = get_best(config_.depth, this->player_color_);
+            last_depth_ = config_.depth;
+            release_cache();
+            return {best_row, best_col};
+        }
+        Position ret = get_best_until(*deadline_);
+        release_cache();
+        return ret;
+    }
+    // a SparseBoard: the search runs in a WindowDeductionBoard around the
+    // stones' bounding box, or around the last move if they don't fit in it;
+    // stones out of the window are left out, the board may well go on past it
+    Position get_best_sparse() const {
+        constexpr int side = WindowDeductionBoard::window_side;
+        constexpr int margin = 16;  // room for the search to grow the box
+        std::vector<Piece> stones = this->board_->stones();
+        if (stones.empty()) { return this->board_->center(); }
+        Position lo{stones.front().row, stones.front().col}, hi = lo;
+        for (const Piece& p : stones) {
+            lo.row = std::min(lo.row, p.row);
+            lo.col = std::min(lo.col, p.col);
+            hi.row = std::max(hi.row, p.row);
+            hi.col = std::max(hi.col, p.col);
+        }
+        Position mid{lo.row + (hi.row - lo.row) / 2, lo.col + (hi.col - lo.col) / 2};
+        if (hi.row - lo.row >= side - 2 * margin || hi.col - lo.col >= side - 2 * margin) {
+            const Piece& last = this->board_->get_last_piece();
+            if (last.get_status()) { mid = {last.row, last.col}; }
+        }
+        Position origin{mid.row - side / 2, mid.col - side / 2};
+        // the part of the window on the board, rows and cols apart
+        Position on_lo{side, side}, on_hi{0, 0};
+        for (int i = 0; i < side; i++) {
+            if (this->board_->is_valid_pos(origin.row + i, mid.col)) {
+                on_lo.row = std::min(on_lo.row, i);
+                on_hi.row = i + 1;
+            }
+            if (this->board_->is_valid_pos(mid.row, origin.col + i)) {
+                on_lo.col = std::min(on_lo.col, i);
+                on_hi.col = i + 1;
+            }
+        }
+        std::vector<PackedMove> local;
+        local.reserve(stones.size());
+        for (const Piece& p : stones) {
+            PackedMove mv{p.row - origin.row, p.col - origin.col, p.color};
+            if (mv.is_valid()) { local.push_back(mv); }
+        }
+        deduction_board_ = std::make_shared<WindowDeductionBoard>(local, on_lo, on_hi);
+        Position ret = search();
+        if (ret.row < 0 || ret.col < 0) { return {}; }
+        return {ret.row + origin.row, ret.col + origin.col};
+    }
+    Position get_best_until(clock_type::time_point deadline) const {
+        timed_out_ = false;
+        log_infer_root(0, this->player_color_);
+        auto [_, best_row, best_col] = get_best(0, this->player_color_);  // depth 0 never times out
+        last_depth_ = 0;
+        clock_type::duration last{}, prev{};
+        for (int depth = 1; depth <= config_.depth; depth++) {
+            auto start = clock_type::now();
+            // skip a depth that can't finish: it grows about as much as the last one did
+            if (last.count() > 0) {
+                double growth = prev.count() > 0 ? std::max(2.0, 1.0 * last.count() / prev.count()) : 4.0;
+                if (start + std::chrono::duration_cast<clock_type::duration>(last * growth) > deadline) { break; }
+            }
+            log_infer_root(depth, this->player_color_);
+            auto [score, row, col] = get_best(depth, this->player_color_);
+            if (timed_out_) { break; }
+            if (row >= 0 && col >= 0) {
+                best_row = row;
+                best_col = col;
+                last_depth_ = depth;
+            }
+            prev = last;
+            last = clock_type::now() - start;
+        }
+        return {best_row, best_col};
+    }
+    // the common sizes (and 15, the standard board) get a constant side,
+    // anything else the engine plays goes through the run-time one
+    bool make_deduction_board(std::vector<std::vector<size_t>>&& board) const {
+        switch (board.size()) {
         case static_cast<size_t>(BoardSize::Small) : {
-            deduction_board_ = std::make_shared<DeductionBoard<BoardSize::Small>>(this->board_->snap());
+            deduction_board_ = std::make_shared<DeductionBoard<13>>(std::move(board));
+        } break;
+        case 15 : {
+            deduction_board_ = std::make_shared<DeductionBoard<15>>(std::move(board));
         } break;
         case static_cast<size_t>(BoardSize::Middle) : {
-            deduction_board_ = std::make_shared<DeductionBoard<BoardSize::Middle>>(this->board_->snap());
+            deduction_board_ = std::make_shared<DeductionBoard<19>>(std::move(board));
         } break;
         case static_cast<size_t>(BoardSize::Large) : {
-            deduction_board_ = std::make_shared<DeductionBoard<BoardSize::Large>>(this->board_->snap());
+            deduction_board_ = std::make_shared<DeductionBoard<25>>(std::move(board));
         } break;
         default:
+            if (is_valid_board_size(board.size())) {
+                deduction_board_ = std::make_shared<DeductionBoard<>>(std::move(board));
+                break;
+            }
             log_error("Deduction board is not correctly created");
-            log_error("bcz the size is: %lu", this->board_->size());
+            log_error("bcz the size is: %lu", board.size());
+            return false;
         }
-        auto [_, best_row, best_col] = get_best(INFERENCE_DEPTH, this->player_color_);
-        return {best_row, best_col};
+        return true;
+    }
+    bool out_of_time() const {
+        if (!timed_out_ && deadline_.has_value() && clock_type::now() >= *deadline_) {
+            timed_out_ = true;
+        }
+        return timed_out_;
     }
     struct cmp {
         bool operator()(const std::tuple<float, int, int>& a, 
                         const std::tuple<float, int, int>& b) const {
             return std::get<0>(a) > std::get<0>(b);
         }
+        bool operator()(const std::pair<float, PackedMove>& a,
+                        const std::pair<float, PackedMove>& b) const {
+            return a.first > b.first;
+        }
     };  // endof struct cmp
-    std::tuple<float, int, int> get_best(int depth, Piece::Color color) const {
+    // a search answer as the cache keeps it, 8 bytes
+    struct CacheEntry {
+        float score;
+        PackedMove move;
+    };  // endof struct CacheEntry
+    // what the root call shows to analyze()
+    struct RootReport {
+        size_t min_choices = 0;  // search at least this many candidates
+        std::vector<std::vector<float>>* heatmap = nullptr;
+        std::vector<std::tuple<float, int, int>> searched;  // candidates with their final score
+    };  // endof struct RootReport
+
+    // the answer of a search only depends on the stones, the side and the depth,
+    // the same position is reached through many move orders (a b c == c b a),
+    // so answers are kept for the rest of the move and read back for the lines
+    static constexpr size_t max_cache_entries = 1 << 18;
+    uint64_t cache_key(uint64_t hash, int depth, Piece::Color color) const {
+        if (color == Piece::Color::Black) { hash ^= BoardHash::side_key(); }
+        return hash ^ (static_cast<uint64_t>(depth + 1) * 0x9E3779B97F4A7C15ULL);
+    }
+    void release_cache() const {
+        std::unordered_map<uint64_t, CacheEntry>().swap(cache_);
+    }
+    // the candidate, then what the cached searches below it answered
+    std::vector<PackedMove> get_line(int depth, Piece::Color color, int row, int col) const {
+        Piece::Color op_color = static_cast<Piece::Color>(Piece::get_op_real_status(color));
+        std::vector<PackedMove> ret{PackedMove{row, col, color}};
+        uint64_t hash = deduction_board_->get_hash() ^ BoardHash::key(row, col, Piece::get_real_status(color));
+        for (; depth > 0; depth--) {
+            auto op_it = cache_.find(cache_key(hash, depth - 1, op_color));
+            if (op_it == cache_.end() || !op_it->second.move.is_valid()) { break; }
+            int op_row = op_it->second.move.row(), op_col = op_it->second.move.col();
+            ret.emplace_back(op_row, op_col, op_color);
+            hash ^= BoardHash::key(op_row, op_col, Piece::get_real_status(op_color));
+            auto next_it = cache_.find(cache_key(hash, depth - 1, color));
+            if (next_it == cache_.end() || !next_it->second.move.is_valid()) { break; }
+            int next_row = next_it->second.move.row(), next_col = next_it->second.move.col();
+            ret.emplace_back(next_row, next_col, color);
+            hash ^= BoardHash::key(next_row, next_col, Piece::get_real_status(color));
+        }
+        return ret;
+    }
+    // root: see RootReport, root call only
+    std::tuple<float, int, int> get_best(int depth, Piece::Color color, RootReport* root=nullptr) const {
         // TODO: 减少计算量：1. 不要全棋盘搜索，而是局限在一定范围
-        //                  2. 存下推导结果，不要重复计算已经出现过的情况
         // if (depth == 0) return get_best(color);
-        std::priority_queue<std::tuple<float, int, int>, std::vector<std::tuple<float, int, int>>, cmp> pq;
-        int num_of_choices = 3 + depth;  // origin : 3
+        if (depth > 0 && out_of_time()) { return {0, -1, -1}; }  // callers skip it like a dead end
+        const uint64_t key = cache_key(deduction_board_->get_hash(), depth, color);
+        if (root == nullptr) {
+            auto it = cache_.find(key);
+            if (it != cache_.end()) { return {it->second.score, it->second.move.row(), it->second.move.col()}; }
+        }
+        const Piece::Color op_color = static_cast<Piece::Color>(Piece::get_op_real_status(color));
+        std::priority_queue<std::pair<float, PackedMove>, std::vector<std::pair<float, PackedMove>>, cmp> pq;
+        int num_of_choices = config_.choices + depth;  // origin : 3
+        if (root) { num_of_choices = std::max<int>(num_of_choices, root->min_choices); }
         size_t sz = deduction_board_->size();
-        assert(deduction_board_->size() > 0 && deduction_board_->size() == (*deduction_board_)[0].size());
-        std::vector<std::vector<float>> score_board(sz, std::vector<float>(sz, 0.0F));  
+        // the score board is the heatmap now, the root call is the only one that keeps it
+        std::vector<std::vector<float>>* score_board = root ? root->heatmap : nullptr;
+        if (score_board) { score_board->assign(sz, std::vector<float>(sz, 0.0F)); }
         // 搞一个score_board把结果存下来的意义在哪呢：debug很好用:D
         
         // 先筛选出最有价值的三个点，后面再详细看
-        for (int row = 0; row < sz; row++) {
-            for (int col = 0; col < sz; col++) {
-                if ((*deduction_board_)[row][col] != 0) { continue; }  // only search empty pos
-                score_board[row][col] += deduction_board_->calc_pos(row, col, color)
-                    + 0.6 * deduction_board_->calc_pos(row, col, Piece::Color{Piece::get_op_real_status(color)});
-                if (pq.size() < num_of_choices || score_board[row][col] - std::get<0>(pq.top()) > 0 - eps) {
-                    while (pq.size() >= num_of_choices) {
-                        pq.pop();
-                    }
-                    pq.emplace(score_board[row][col], row, col);
+        auto visit = [&](int row, int col) {
+            float score = deduction_board_->calc_pos(row, col, color)
+                + config_.op_weight * deduction_board_->calc_pos(row, col, op_color);
+            if (score_board) { (*score_board)[row][col] = score; }
+            if (pq.size() < num_of_choices || score - std::get<0>(pq.top()) > 0 - eps) {
+                while (pq.size() >= num_of_choices) {
+                    pq.pop();
+                }
+                pq.emplace(score, PackedMove{row, col, color});
+            }
+        };
+        std::vector<PackedMove> cands;
+        if (deduction_board_->candidates(cands)) {  // sparse: around the stones only
+            for (PackedMove mv : cands) { visit(mv.row(), mv.col()); }
+        } else {
+            for (int row = 0; row < sz; row++) {
+                for (int col = 0; col < sz; col++) {
+                    if (deduction_board_->at(row, col) != 0) { continue; }  // only search empty pos
+                    visit(row, col);
                 }
             }
         }
         size_t pq_size = pq.size();
         if (pq.empty()) { return {0, -1, -1}; }  // invalid piece
-        auto [max_score, best_row, best_col] = pq.top();
+        float max_score = pq.top().first;
+        int best_row = pq.top().second.row(), best_col = pq.top().second.col();
         // float max_score = INT_MIN / 2;
         // int best_row = -1, best_col = -1;
         int best_score_num = 1;
         while (!pq.empty()) {
-            auto [now_score, row, col] = pq.top();
+            auto [now_score, mv] = pq.top();
+            int row = mv.row(), col = mv.col();
             pq.pop();
             log_infer_pq_top_pos(depth, row, col, now_score, pq_size - pq.size());
             if (depth <= 0) {
                 log_infer_max_depth(depth);
             } else {
                 log_infer_this_move(depth, color, row, col);
-                deduction_board_->deduce_new_piece(Piece{row, col, color}, depth);
-                auto [op_score, op_row, op_col] = get_best(depth - 1, Piece::Color{Piece::get_op_real_status(color)});  // 不应该反向吗？就像这样
+                deduction_board_->deduce_new_piece(mv, depth);
+                auto [op_score, op_row, op_col] = get_best(depth - 1, op_color);  // 不应该反向吗？就像这样
                 if (op_row < 0 || op_col < 0) {
-                    deduction_board_->deduce_reset_pos(Position{row, col});
+                    deduction_board_->deduce_reset_pos(mv);
                     continue;
                 }
                 log_infer_op_move(depth, color, op_row, op_col);
-                deduction_board_->deduce_new_piece(Piece{op_row, op_col, Piece::Color{Piece::get_op_real_status(color)}}, depth);
+                PackedMove op_mv{op_row, op_col, op_color};
+                deduction_board_->deduce_new_piece(op_mv, depth);
                 auto [_, next_row, next_col] = get_best(depth - 1, color);
                 if (next_row < 0 || next_col < 0) {
-                    deduction_board_->deduce_reset_pos(Position{row, col});
-                    deduction_board_->deduce_reset_pos(Position{op_row, op_col});
+                    deduction_board_->deduce_reset_pos({mv, op_mv});
                     continue;
                 }
                 log_infer_next_move(depth, color, next_row, next_col);
-                deduction_board_->deduce_new_piece(Piece{next_row, next_col, color}, depth);
+                PackedMove next_mv{next_row, next_col, color};
+                deduction_board_->deduce_new_piece(next_mv, depth);
                 float next_eval = deduction_board_->calc_pos(row, col, color)
-                    + 0.6 * deduction_board_->calc_pos(row, col, Piece::Color{Piece::get_op_real_status(color)});
-                now_score += 0.2 * next_eval;
-                deduction_board_->deduce_reset_pos(Position{row, col});
-                deduction_board_->deduce_reset_pos(Position{op_row, op_col});
-                deduction_board_->deduce_reset_pos(Position{next_row, next_col});
+                    + config_.op_weight * deduction_board_->calc_pos(row, col, op_color);
+                now_score += config_.next_weight * next_eval;
+                deduction_board_->deduce_reset_pos({mv, op_mv, next_mv});
+            }
+            if (root) {
+                if (root->heatmap) { (*root->heatmap)[row][col] = now_score; }
+                root->searched.emplace_back(now_score, row, col);
             }
             
             if (std::fabs(now_score - max_score) <= eps) {
                 best_score_num++;
-                if (rand() % best_score_num < 1) {
+                if (roll() % best_score_num < 1) {
                     best_row = row;
                     best_col = col;
                 }
@@ -398,62 +824,94 @@ private:
                 // score < max_score
             }
         }
+        if (!timed_out_ && cache_.size() < max_cache_entries) {  // a timed out answer is partial
+            cache_.emplace(key, CacheEntry{max_score, PackedMove{best_row, best_col, color}});
+        }
         return {max_score, best_row, best_col};
     }
 
+    // a root search starts here, logE's index finds a decision by this line
+    // ply: stones on the board, as anaE counts them
+    void log_infer_root(int depth, Piece::Color color) const {
+        if (!log_on(INFER, INFER)) { return ; }
+        size_t ply = 0;
+        for (size_t row = 0; row < deduction_board_->size(); row++) {
+            for (size_t col = 0; col < deduction_board_->size(); col++) {
+                ply += deduction_board_->at(row, col) != 0;
+            }
+        }
+#ifndef __LOG_INFERENCE_ELSEWHERE__
+        log_infer_at(depth, "[@] searching %s player's move %lu, depth %d",
+                     Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
+                     ply, depth);
+#else  // __LOG_INFERENCE_ELSEWHERE__
+        log_infer_at(depth, "@ %s %lu %d", Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
+                     ply, depth);
+#endif // __LOG_INFERENCE_ELSEWHERE__
+    }
     static void log_infer_pq_top_pos(size_t depth, int row, int col, float now_score, size_t seq) {
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "Prior #%lu pos: [%d, %d], score: %.2f", seq, row, col, now_score);
+        log_infer_at(depth, "Prior #%lu pos: [%d, %d], score: %.2f", seq, row, col, now_score);
 #else  // __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "- %d %d %.2f", row, col, now_score);
+        log_infer_at(depth, "- %d %d %.2f", row, col, now_score);
 #endif // __LOG_INFERENCE_ELSEWHERE__
     }
     static void log_infer_max_depth(size_t depth) {
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        log_infer(XQ4GB_TIMESTAMP, depth, "max depth met");
+        log_infer_at(XQ4GB_TIMESTAMP, depth, "max depth met");
 #else  // __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "!");
+        log_infer_at(depth, "!");
 #endif // __LOG_INFERENCE_ELSEWHERE__
     }
     static void log_infer_this_move(size_t depth, Piece::Color color, int row, int col) {
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "[1] infering %s player's optional pos: [%d, %d]",
-                  Piece::get_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
-                  row, col);
+        log_infer_at(depth, "[1] infering %s player's optional pos: [%d, %d]",
+                     Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
+                     row, col);
 #else  // __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "1 %s %d %d", Piece::get_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
-                  row, col);
+        log_infer_at(depth, "1 %s %d %d", Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
+                     row, col);
 #endif // __LOG_INFERENCE_ELSEWHERE__
     }
     static void log_infer_op_move(size_t depth, Piece::Color color, int op_row, int op_col) {
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "[2] infering %s player's optional pos: [%d, %d]",
-                  Piece::get_op_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
-                  op_row, op_col);
+        log_infer_at(depth, "[2] infering %s player's optional pos: [%d, %d]",
+                     Piece::get_op_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
+                     op_row, op_col);
 #else  // __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "2 %s %d %d", Piece::get_op_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
-                  op_row, op_col);
+        log_infer_at(depth, "2 %s %d %d", Piece::get_op_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
+                     op_row, op_col);
 #endif // __LOG_INFERENCE_ELSEWHERE__
     }
+    unsigned roll() const {
+        return rng_.has_value() ? static_cast<unsigned>((*rng_)() >> 1) : static_cast<unsigned>(rand());
+    }
     static void log_infer_next_move(size_t depth, Piece::Color color, int next_row, int next_col) {
 #ifndef __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "[3] infering %s player's optional pos: [%d, %d]",
-                  Piece::get_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
-                  next_row, next_col);
+        log_infer_at(depth, "[3] infering %s player's optional pos: [%d, %d]",
+                     Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "black" : "white", 
+                     next_row, next_col);
 #else // __LOG_INFERENCE_ELSEWHERE__
-        log_infer(depth, "3 %s %d %d", Piece::get_real_status(color) == 
-                  static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
-                  next_row, next_col);
+        log_infer_at(depth, "3 %s %d %d", Piece::get_real_status(color) == 
+                     static_cast<size_t>(Piece::Color::Black) ? "b" : "w", 
+                     next_row, next_col);
 #endif // __LOG_INFERENCE_ELSEWHERE__
     }
     
     mutable std::shared_ptr<DeductionBoard_base> deduction_board_;
-                    
+    HumanLikeConfig config_;
+    std::optional<clock_type::time_point> deadline_;
+    mutable bool timed_out_ = false;
+    mutable int last_depth_ = 0;
+    mutable std::unordered_map<uint64_t, CacheEntry> cache_;  // see cache_key()
+    mutable std::optional<std::mt19937> rng_;  // nullopt: rand(), as the games always did
 };  // endof class HumanLikeRobot
 
 class SmartRobot : public RobotPlayer {
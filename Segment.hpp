@@ -0,0 +1,292 @@
+#ifndef __SEGMENT_HPP__
+#define __SEGMENT_HPP__
+
+#include "common.hpp"
+
+namespace mfwu {
+
+/*
+    segment file: many games (or any text) in one file,
+    cut into independently compressed blocks, little endian
+
+        file header  : char[4] "GBSG", u16 version, u16 codec
+        block header : char[4] "GBBK", u32 raw length,
+                       u32 stored length (high bit set: stored raw),
+                       u32 crc32 of the raw bytes
+        block payload: stored length bytes
+
+    codec 1 is a small lz77 in the spirit of lz4's block format:
+        token  : high nibble literal length, low nibble match length - 4
+                 (15 means more length bytes follow, each 255 adds on)
+        literals, then u16 offset back into the output, then the match
+        the last sequence has literals only
+*/
+class SegmentCodec {
+public:
+    static constexpr size_t min_match = 4;
+    static constexpr size_t hash_bits = 13;
+    static constexpr size_t max_offset = 65535;
+    static constexpr size_t last_literals = 5;  // keeps the decoder's tail simple
+
+    static void compress(const char* src, size_t n, std::string& dst) {
+        dst.clear();
+        dst.reserve(n / 2 + 16);
+        std::vector<int64_t> table(1UL << hash_bits, -1);
+        size_t anchor = 0, i = 0;
+        while (n >= last_literals + min_match && i + min_match <= n - last_literals) {
+            uint32_t seq = read32(src + i);
+            size_t h = hash(seq);
+            int64_t cand = table[h];
+            table[h] = i;
+            if (cand < 0 || i - cand > max_offset || read32(src + cand) != seq) {
+                i++;
+                continue;
+            }
+            size_t len = min_match;
+            while (i + len < n - last_literals && src[cand + len] == src[i + len]) {
+                len++;
+            }
+            put_sequence(dst, src + anchor, i - anchor, i - cand, len);
+            i += len;
+            anchor = i;
+        }
+        put_sequence(dst, src + anchor, n - anchor, 0, 0);
+    }
+    // the most compress() can write for n bytes: all literals, a length byte per 255
+    static constexpr size_t max_compressed(size_t n) {
+        return n + n / 255 + 16;
+    }
+    // false if the input is broken, dst gets exactly raw_len bytes otherwise
+    static bool decompress(const char* src, size_t n, char* dst, size_t raw_len) {
+        const uint8_t* ip = reinterpret_cast<const uint8_t*>(src);
+        const uint8_t* iend = ip + n;
+        size_t op = 0;
+        while (ip < iend) {
+            uint8_t token = *ip++;
+            size_t lit = token >> 4;
+            if (lit == 15 && !get_length(ip, iend, lit)) { return false; }
+            if (lit > static_cast<size_t>(iend - ip) || op + lit > raw_len) { return false; }
+            memcpy(dst + op, ip, lit);
+            ip += lit; op += lit;
+            if (ip == iend) { break; }  // last sequence
+            if (iend - ip < 2) { return false; }
+            size_t offset = ip[0] | (ip[1] << 8);
+            ip += 2;
+            size_t len = token & 15;
+            if (len == 15 && !get_length(ip, iend, len)) { return false; }
+            len += min_match;
+            if (offset == 0 || offset > op || op + len > raw_len) { return false; }
+            for (size_t k = 0; k < len; k++, op++) {  // may overlap, copy forward
+                dst[op] = dst[op - offset];
+            }
+        }
+        return op == raw_len;
+    }
+
+private:
+    static uint32_t read32(const char* p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static size_t hash(uint32_t seq) {
+        return (seq * 2654435761U) >> (32 - hash_bits);
+    }
+    static void put_length(std::string& dst, size_t len) {
+        while (len >= 255) {
+            dst += static_cast<char>(255);
+            len -= 255;
+        }
+        dst += static_cast<char>(len);
+    }
+    static bool get_length(const uint8_t*& ip, const uint8_t* iend, size_t& len) {
+        uint8_t b;
+        do {
+            if (ip >= iend) { return false; }
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    }
+    static void put_sequence(std::string& dst, const char* lit, size_t lit_len,
+                             size_t offset, size_t match_len) {
+        size_t ml = match_len ? match_len - min_match : 0;
+        dst += static_cast<char>((std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(ml, 15));
+        if (lit_len >= 15) { put_length(dst, lit_len - 15); }
+        dst.append(lit, lit_len);
+        if (match_len == 0) { return ; }
+        dst += static_cast<char>(offset & 0xFF);
+        dst += static_cast<char>(offset >> 8);
+        if (ml >= 15) { put_length(dst, ml - 15); }
+    }
+};  // endof class SegmentCodec
+
+inline uint32_t crc32(const char* data, size_t n, uint32_t crc=0) {
+    static const std::array<uint32_t, 256> table = [](){
+        std::array<uint32_t, 256> t = {};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+class Segment {
+public:
+    static constexpr const char file_magic[4]  = {'G', 'B', 'S', 'G'};
+    static constexpr const char block_magic[4] = {'G', 'B', 'B', 'K'};
+    static constexpr uint16_t version = 1;
+    static constexpr uint16_t codec = 1;
+    static constexpr size_t file_header_len = 8;
+    static constexpr size_t block_header_len = 16;
+    static constexpr size_t max_block = 1UL << 22;  // raw bytes per block
+    static constexpr uint32_t stored_flag = 1U << 31;
+
+    static std::string file_header() {
+        std::string ret(file_magic, 4);
+        put<uint16_t>(ret, version);
+        put<uint16_t>(ret, codec);
+        return ret;
+    }
+    // appends one or more blocks holding `raw` to `out`
+    static void encode(const char* raw, size_t n, std::string& out) {
+        std::string comp;
+        for (size_t off = 0; off < n; off += max_block) {
+            size_t len = std::min(max_block, n - off);
+            SegmentCodec::compress(raw + off, len, comp);
+            bool stored = comp.size() >= len;
+            out.append(block_magic, 4);
+            put<uint32_t>(out, static_cast<uint32_t>(len));
+            put<uint32_t>(out, static_cast<uint32_t>(stored ? len : comp.size()) | (stored ? stored_flag : 0));
+            put<uint32_t>(out, crc32(raw + off, len));
+            if (stored) { out.append(raw + off, len); }
+            else { out += comp; }
+        }
+    }
+    // true if the stream starts with a segment file header, nothing is consumed
+    static bool is_segment(std::istream& is) {
+        char magic[4] = {};
+        auto pos = is.tellg();
+        is.read(magic, 4);
+        bool ret = is.gcount() == 4 && memcmp(magic, file_magic, 4) == 0;
+        is.clear();
+        is.seekg(pos);
+        return ret;
+    }
+
+    template <typename T>
+    static void put(std::string& out, T val) {
+        out.append(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+    template <typename T>
+    static T get(const char* p) {
+        T val;
+        memcpy(&val, p, sizeof(T));
+        return val;
+    }
+};  // endof class Segment
+
+/*
+    streaming decompressor, one block in memory at a time
+    wrap it in a std::istream and read as if it were the plain text:
+        SegmentStreamBuf buf(ifs); std::istream is(&buf);
+    a block with a bad checksum is skipped and counted
+*/
+class SegmentStreamBuf : public std::streambuf {
+public:
+    SegmentStreamBuf(std::istream& src) : src_(src) {
+        char header[Segment::file_header_len];
+        src_.read(header, sizeof(header));
+        status_ = src_.gcount() == sizeof(header)
+                  && memcmp(header, Segment::file_magic, 4) == 0
+                  && Segment::get<uint16_t>(header + 6) == Segment::codec;
+        if (!status_) {
+            std::cerr << "segment: bad file header\n";
+        }
+    }
+    bool get_status() const { return status_; }
+    size_t get_bad_blocks() const { return bad_blocks_; }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        while (status_ && load_block() == false) {}
+        if (!status_ || raw_.empty()) { return traits_type::eof(); }
+        setg(raw_.data(), raw_.data(), raw_.data() + raw_.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    // false if the block was broken and skipped, status_ drops at eof
+    bool load_block() {
+        raw_.clear();
+        char header[Segment::block_header_len];
+        src_.read(header, sizeof(header));
+        if (src_.gcount() == 0) {
+            status_ = false;  // clean eof
+            return true;
+        }
+        if (src_.gcount() != sizeof(header) || memcmp(header, Segment::block_magic, 4) != 0) {
+            std::cerr << "segment: lost block boundary, stop reading\n";
+            bad_blocks_++;
+            status_ = false;
+            return true;
+        }
+        uint32_t raw_len = Segment::get<uint32_t>(header + 4);
+        uint32_t stored = Segment::get<uint32_t>(header + 8);
+        uint32_t crc = Segment::get<uint32_t>(header + 12);
+        size_t len = stored & ~Segment::stored_flag;
+        // lengths no writer can produce: nothing to allocate for, and no
+        // way to find the next block either
+        if (raw_len > Segment::max_block || len > SegmentCodec::max_compressed(Segment::max_block)) {
+            std::cerr << "segment: bad block header, stop reading\n";
+            bad_blocks_++;
+            status_ = false;
+            return true;
+        }
+        comp_.resize(len);
+        src_.read(comp_.data(), len);
+        if (static_cast<size_t>(src_.gcount()) != len) {
+            std::cerr << "segment: truncated block\n";
+            bad_blocks_++;
+            status_ = false;
+            return true;
+        }
+        raw_.resize(raw_len);
+        bool ok = false;
+        if (stored & Segment::stored_flag) {
+            ok = len == raw_len;
+            if (ok) { memcpy(raw_.data(), comp_.data(), len); }
+        } else {
+            ok = SegmentCodec::decompress(comp_.data(), len, raw_.data(), raw_len);
+        }
+        if (!ok || crc32(raw_.data(), raw_len) != crc) {
+            std::cerr << "segment: bad block skipped\n";
+            bad_blocks_++;
+            raw_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    std::istream& src_;
+    std::vector<char> comp_;
+    std::vector<char> raw_;
+    bool status_ = false;
+    size_t bad_blocks_ = 0;
+};  // endof class SegmentStreamBuf
+
+}  // endof namespace mfwu
+
+#endif  // __SEGMENT_HPP__
@@ -0,0 +1,163 @@
+#ifndef __SPARSEBOARD_HPP__
+#define __SPARSEBOARD_HPP__
+
+#include "ChessBoard.hpp"
+
+namespace mfwu {
+
+/*
+    a board without a grid: only the stones, in a hash map keyed by [row, col]
+    for boards too large to scan, or with no edge at all (infinite gomoku),
+    every call costs in stones played, not in area
+    side 0: unbounded, rows and cols run over [0, unbounded_side) and a game
+    starts at center(), half a billion cells from any edge: never met,
+    and [-1, -1] keeps meaning "no move" for the players
+    no display and no input, like HeadlessBoard
+*/
+class SparseBoard : public ChessBoard_base {
+public:
+    static constexpr int unbounded_side = 1 << 30;
+
+    explicit SparseBoard(size_t side=0)
+        : size_(side), side_(side ? static_cast<int>(side) : unbounded_side) {
+        reset();
+    }
+
+    void reset() override {
+        cells_.clear();
+        last_piece_ = invalid_piece;
+    }
+    void update(const Piece& piece) override {
+        if (!is_valid_pos(piece.row, piece.col)) {
+            log_error("Invalid piece should not be placed");
+            return ;
+        }
+        rm_last_sp();
+        last_piece_ = Piece{piece.row, piece.col,
+                            static_cast<Piece::Color>(piece.get_status() + 1)};
+        cells_[key(piece.row, piece.col)] = static_cast<uint8_t>(last_piece_.get_status());
+    }
+    size_t size() const override { return size_; }  // 0: unbounded
+    size_t get_status(int row, int col) const override {
+        auto it = cells_.find(key(row, col));
+        return it == cells_.end() ? 0 : it->second;
+    }
+    std::optional<Command> poll_command(int) override {
+        return Command{CommandType::QUIT, {}};  // nobody to ask
+    }
+    void show() const override {}
+    void refresh() override {}
+    void winner_display(const Piece::Color&) override {}
+
+    int count_left(const Piece& piece) const override { return count_line(piece, 0, -1); }
+    int count_right(const Piece& piece) const override { return count_line(piece, 0, 1); }
+    int count_up(const Piece& piece) const override { return count_line(piece, -1, 0); }
+    int count_down(const Piece& piece) const override { return count_line(piece, 1, 0); }
+    int count_up_left(const Piece& piece) const override { return count_line(piece, -1, -1); }
+    int count_up_right(const Piece& piece) const override { return count_line(piece, -1, 1); }
+    int count_down_left(const Piece& piece) const override { return count_line(piece, 1, -1); }
+    int count_down_right(const Piece& piece) const override { return count_line(piece, 1, 1); }
+
+    int count_dir(const Piece& piece, const std::pair<int, int>& dir) const override {
+        return count_line(piece, dir.first, dir.second);
+    }
+    void count_dir(const Piece& piece, count_res_8* res) const override {
+        res->right = count_right(piece);
+        res->down = count_down(piece);
+        res->left = count_left(piece);
+        res->up = count_up(piece);
+        res->down_right = count_down_right(piece);
+        res->down_left = count_down_left(piece);
+        res->up_right = count_up_right(piece);
+        res->up_left = count_up_left(piece);
+    }
+    void count_dir(const Piece& piece, count_res_4* res) const override {
+        res->left_right = count_left(piece) + count_right(piece);
+        res->up_down    = count_up(piece) + count_down(piece);
+        res->up_left_down_right = count_up_left(piece) + count_down_right(piece);
+        res->up_right_down_left = count_up_right(piece) + count_down_left(piece);
+    }
+
+    // "row col status" a stone per line, row-major
+    std::string serialize() const override {
+        std::stringstream ss;
+        for (const Piece& p : stones()) {
+            ss << p.row << " " << p.col << " " << p.get_status() << "\n";
+        }
+        return ss.str();
+    }
+    // the bounding box of the stones as a grid, [0, 0] is box_origin()
+    std::vector<std::vector<size_t>> snap() const override {
+        if (cells_.empty()) { return {}; }
+        auto [lo, hi] = box();
+        std::vector<std::vector<size_t>> res(hi.row - lo.row + 1,
+                                             std::vector<size_t>(hi.col - lo.col + 1));
+        for (const auto& [k, status] : cells_) {
+            res[row_of(k) - lo.row][col_of(k) - lo.col] = status;
+        }
+        return res;
+    }
+    Position box_origin() const { return box().first; }
+
+    bool is_valid_pos(int row, int col) const override {
+        return row >= 0 && row < side_ && col >= 0 && col < side_;
+    }
+    bool is_full() const override {
+        return cells_.size() >= static_cast<uint64_t>(side_) * side_;
+    }
+    bool is_sparse() const override { return true; }
+    Position center() const override { return {side_ / 2, side_ / 2}; }
+    std::vector<Piece> stones() const override {
+        std::vector<Piece> ret;
+        ret.reserve(cells_.size());
+        for (const auto& [k, status] : cells_) {
+            ret.emplace_back(row_of(k), col_of(k), static_cast<Piece::Color>(status));
+        }
+        std::sort(ret.begin(), ret.end(), [](const Piece& a, const Piece& b) {
+            return a.row != b.row ? a.row < b.row : a.col < b.col;
+        });
+        return ret;
+    }
+
+private:
+    static uint64_t key(int row, int col) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) | static_cast<uint32_t>(col);
+    }
+    static int row_of(uint64_t k) { return static_cast<int>(k >> 32); }
+    static int col_of(uint64_t k) { return static_cast<int>(k & 0xFFFFFFFFULL); }
+
+    int count_line(const Piece& piece, int inc_r, int inc_c) const {
+        size_t status = piece.get_status();
+        int cnt = 0;
+        for (int row = piece.row + inc_r, col = piece.col + inc_c;
+             is_valid_pos(row, col); row += inc_r, col += inc_c) {
+            if (!Piece::is_same_color(get_status(row, col), status)) { break; }
+            cnt++;
+        }
+        return cnt;
+    }
+    // [top left, bottom right] of the stones
+    std::pair<Position, Position> box() const {
+        Position lo{side_, side_}, hi{-1, -1};
+        for (const auto& [k, status] : cells_) {
+            lo.row = std::min(lo.row, row_of(k));
+            lo.col = std::min(lo.col, col_of(k));
+            hi.row = std::max(hi.row, row_of(k));
+            hi.col = std::max(hi.col, col_of(k));
+        }
+        return {lo, hi};
+    }
+    void rm_last_sp() {
+        if (last_piece_.get_status() == 0) { return ; }  // empty last_piece
+        last_piece_.color = static_cast<Piece::Color>(last_piece_.get_status() - 1);
+        cells_[key(last_piece_.row, last_piece_.col)] = static_cast<uint8_t>(last_piece_.get_status());
+    }
+
+    size_t size_;
+    int side_;
+    std::unordered_map<uint64_t, uint8_t> cells_;  // status of each stone
+};  // endof class SparseBoard
+
+}  // endof namespace mfwu
+
+#endif  // __SPARSEBOARD_HPP__
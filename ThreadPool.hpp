@@ -0,0 +1,77 @@
+#ifndef __THREADPOOL_HPP__
+#define __THREADPOOL_HPP__
+
+#include "common.hpp"
+
+namespace mfwu {
+
+/*
+    fixed set of workers over one FIFO queue
+    robot searches of every session share it, so a busy box runs
+    as many searches at once as it has cores, not as it has users
+*/
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t workers=std::thread::hardware_concurrency()) {
+        workers = std::max<size_t>(workers, 1);
+        threads_.reserve(workers);
+        for (size_t i = 0; i < workers; i++) {
+            threads_.emplace_back(&ThreadPool::work, this);
+        }
+    }
+    // runs what is queued, then joins
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (std::thread& t : threads_) { t.join(); }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads_.size(); }
+    size_t pending() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return tasks_.size();
+    }
+
+    template <typename Func>
+    auto submit(Func&& func) -> std::future<decltype(func())> {
+        using Ret_type = decltype(func());
+        auto task = std::make_shared<std::packaged_task<Ret_type()>>(std::forward<Func>(func));
+        std::future<Ret_type> ret = task->get_future();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            tasks_.emplace_back([task](){ (*task)(); });
+        }
+        cv_.notify_one();
+        return ret;
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                cv_.wait(lk, [this](){ return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) { return ; }  // stop_ and nothing left
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> tasks_;
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+};  // endof class ThreadPool
+
+}  // endof namespace mfwu
+
+#endif  // __THREADPOOL_HPP__
@@ -0,0 +1,129 @@
+#define __HEADLESS_MODE__  // stdout is the report, only warnings go to ./log
+#define __LOG_INFERENCE_ELSEWHERE__  // a search per position, the tree would dwarf the report
+#define __LOG_MIN_LEVEL__ 3  // WARN and up, debug and inference calls compile to nothing
+
+#include <iostream>
+#include <chrono>
+#include "common.hpp"
+#include "ArchiveReader.hpp"
+#include "Analyzer.hpp"
+
+namespace mfwu {
+
+constexpr const char* archive_dir = "./archive/";
+constexpr size_t batch_positions = 4096;  // positions in memory at once
+
+void print_usage() {
+    std::cerr << "usage: ./anaE [-j workers] [-d depth] [-k top_k] [-l lines] [input.arc|input.seg ...]\n"
+              << "    every position of every game, the robot's move for the side to move:\n"
+              << "    game ply color best score [candidates ...] [| score line ...]\n"
+              << "    moves typed as in the game\n"
+              << "    -j  threads, default: every core\n"
+              << "    -d  search depth, default: " << INFERENCE_DEPTH << "\n"
+              << "    -k  candidates per position, default: 0\n"
+              << "    -l  ranked lines (multi-pv) per position, default: 0\n"
+              << "    inputs default to every .arc/.seg file in " << archive_dir << "\n";
+}
+
+std::string pos2str(int row, int col) {
+    return {static_cast<char>('a' + row), static_cast<char>('a' + col)};
+}
+
+struct PositionTag {
+    size_t game;
+    size_t ply;
+};  // endof struct PositionTag
+
+void flush_batch(Analyzer& analyzer, std::vector<AnalysisRequest>& reqs,
+                 std::vector<PositionTag>& tags) {
+    std::vector<AnalysisResult> results = analyzer.evaluate(reqs);
+    for (size_t i = 0; i < results.size(); i++) {
+        const AnalysisResult& res = results[i];
+        std::cout << tags[i].game << ' ' << tags[i].ply << ' '
+                  << (reqs[i].color == Piece::Color::Black ? "black" : "white") << ' ';
+        if (!res.ok) {
+            std::cout << "-\n";
+            continue;
+        }
+        std::cout << pos2str(res.row, res.col) << ' ' << res.score;
+        for (const AnalysisCandidate& cand : res.candidates) {
+            std::cout << ' ' << pos2str(cand.row, cand.col) << ':' << cand.score;
+        }
+        for (const SearchLine& line : res.lines) {
+            std::cout << " | " << line.score;
+            for (PackedMove p : line.moves) { std::cout << ' ' << pos2str(p.row(), p.col()); }
+        }
+        std::cout << '\n';
+    }
+    reqs.clear();
+    tags.clear();
+}
+
+}  // endof namespace mfwu
+
+int main(int argc, char** argv) {
+    size_t workers = std::thread::hardware_concurrency();
+    size_t top_k = 0;
+    size_t num_lines = 0;
+    mfwu::HumanLikeConfig config;
+    std::vector<std::string> in_filenames;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            workers = atol(argv[++i]);
+        } else if (arg == "-d" && i + 1 < argc) {
+            config.depth = atoi(argv[++i]);
+        } else if (arg == "-k" && i + 1 < argc) {
+            top_k = atol(argv[++i]);
+        } else if (arg == "-l" && i + 1 < argc) {
+            num_lines = atol(argv[++i]);
+        } else if (arg[0] == '-') {
+            mfwu::print_usage();
+            return -1;
+        } else {
+            in_filenames.push_back(arg);
+        }
+    }
+    if (in_filenames.empty()) {
+        in_filenames = mfwu::ArchiveFile::list_dir(mfwu::archive_dir);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    mfwu::Analyzer analyzer(workers, config);
+    std::vector<mfwu::AnalysisRequest> reqs;
+    std::vector<mfwu::PositionTag> tags;
+    size_t games = 0, positions = 0;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& in_filename : in_filenames) {
+        mfwu::ArchiveFile file(in_filename);
+        if (!file.is_open()) {
+            std::cerr << "cannot open " << in_filename << ", skipped\n";
+            continue;
+        }
+        mfwu::ArchiveReader reader(file.stream());
+        mfwu::ArchiveGame game;
+        while (reader.next(game)) {
+            if (game.moves.empty()) { continue; }
+            std::vector<std::vector<size_t>> board(game.size, std::vector<size_t>(game.size, 0));
+            // the position before each move, the played move is left to the reader to compare
+            for (size_t ply = 0; ply < game.moves.size(); ply++) {
+                mfwu::PackedMove p = game.moves[ply];
+                reqs.push_back({board, p.color(), top_k, num_lines});
+                tags.push_back({games, ply});
+                board[p.row()][p.col()] = p.get_real_status();
+                if (reqs.size() >= mfwu::batch_positions) {
+                    positions += reqs.size();
+                    mfwu::flush_batch(analyzer, reqs, tags);
+                }
+            }
+            games++;
+        }
+    }
+    positions += reqs.size();
+    mfwu::flush_batch(analyzer, reqs, tags);
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "games: " << games << ", positions: " << positions
+              << ", workers: " << analyzer.get_workers()
+              << ", " << sec << "s\n";
+    return 0;
+}
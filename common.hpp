@@ -3,6 +3,7 @@
 
 #include <bits/stdc++.h>  // TODO: temp
 #include "constdef.hpp"
+#include "InputPoller.hpp"
 
 #define likely(x)       __builtin_expect(!!(x), 1)
 #define unlikely(x)     __builtin_expect(!!(x), 0)
@@ -10,29 +11,36 @@
 namespace mfwu {
     
 enum class BoardSize : size_t {
+    Dynamic = 0,  // the side comes at run time, see is_valid_board_size
     Small  = 13,
     Middle = 19,
     Large  = 25
 };  // endof enum class BoardSize
+// what the engine (boards without a screen, the search) can play,
+// the screens and the archives stick to the three above
+constexpr size_t min_board_size = 7;
+constexpr size_t max_board_size = 32;
+inline bool is_valid_board_size(size_t size) {
+    return size >= min_board_size && size <= max_board_size;
+}
 const std::unordered_map<size_t, std::string> BoardSizeDescription = {
     {0, "Small"}, {1, "Middle"}, {2, "Large"}
 };
 
 /* dual ints, -1 for invalid res */
+// no virtuals: plain values, copied around by the thousand in the search
 struct Position {
     int row, col;
 
     Position() : row(-1), col(-1) {}
     Position(int r, int c) : row(r), col(c) {}
     Position(const Position& pos) = default;
+    Position& operator=(const Position& pos) = default;
 
     void update(int r, int c) {
         row = r;
         col = c;
     }
-    virtual size_t get_status() const { return 0; }
-
-    virtual ~Position() {}
 
     bool operator==(const Position& p) {
         return row == p.row && col == p.col;
@@ -43,7 +51,7 @@ struct Position {
 };  // endof struct Position
 
 struct Piece : public Position {
-    enum class Color : size_t {
+    enum class Color : uint8_t {
         Invalid = 0,
         White   = 1,
         WhiteSp = 2,
@@ -98,7 +106,6 @@ struct Piece : public Position {
         : Position(r, c), color(clr) {}
     Piece(const Position& pos, Color clr)
         : Position(pos), color(clr) {}
-    virtual ~Piece() {}
 
     bool operator==(const Piece& p) const {
         return    this->row == p.row 
@@ -110,6 +117,51 @@ struct Piece : public Position {
     }
 };  // endof struct Piece
 const Piece invalid_piece = Piece{-1, -1, Piece::Color::Invalid};
+static_assert(std::is_trivially_copyable_v<Piece> && sizeof(Piece) == 12);
+
+/*
+    a move in 16 bits, for whatever keeps many of them: search stacks and
+    caches, games read from archives, engine move lists
+        row: 7 bits | col: 7 bits | color: 2 bits (0 none, 1 white, 2 black)
+    real colors only, the sp statuses stay with the boards and the screen
+*/
+struct PackedMove {
+    static constexpr uint16_t invalid_bits = 0xFFFF;
+    static constexpr int max_side = 127;
+
+    uint16_t bits = invalid_bits;
+
+    constexpr PackedMove() = default;
+    constexpr PackedMove(int row, int col, Piece::Color color=Piece::Color::Invalid)
+        : bits(pack(row, col, color)) {}
+    constexpr PackedMove(const Piece& p) : bits(pack(p.row, p.col, p.color)) {}
+
+    bool is_valid() const { return bits != invalid_bits; }
+    int row() const { return is_valid() ? bits >> 9 : -1; }
+    int col() const { return is_valid() ? (bits >> 2) & 0x7F : -1; }
+    Piece::Color color() const {
+        switch (bits & 3) {
+        case 1 : return Piece::Color::White;
+        case 2 : return Piece::Color::Black;
+        default : return Piece::Color::Invalid;
+        }
+    }
+    size_t get_real_status() const { return static_cast<size_t>(color()); }
+    Position get_pos() const { return {row(), col()}; }
+    Piece to_piece() const { return {row(), col(), color()}; }
+
+    bool operator==(const PackedMove& mv) const { return bits == mv.bits; }
+    bool operator!=(const PackedMove& mv) const { return bits != mv.bits; }
+
+private:
+    static constexpr uint16_t pack(int row, int col, Piece::Color color) {
+        if (row < 0 || col < 0 || row >= max_side || col >= max_side) { return invalid_bits; }
+        uint16_t code = color == Piece::Color::White || color == Piece::Color::WhiteSp ? 1
+                      : color == Piece::Color::Black || color == Piece::Color::BlackSp ? 2 : 0;
+        return static_cast<uint16_t>((row << 9) | (col << 2) | code);
+    }
+};  // endof struct PackedMove
+static_assert(std::is_trivially_copyable_v<PackedMove> && sizeof(PackedMove) == 2);
 
 const std::vector<std::pair<int, int>> dirs = {
     {1, 0}, {0, 1}, {-1, 0}, {0, -1},
@@ -184,6 +236,16 @@ const std::unordered_map<size_t, std::string> GameStatusDescription = {
     {3, "QUIT"}, {4, "INVALID"}, {5, "XQ4GB"}
 };
 
+// what the debug log keeps of the board, once per move
+// rendering never logs anything
+enum class BoardLogMode : size_t {
+    NONE   = 0,
+    MOVE   = 1,  // "Move #12: black [6, 7]"
+    ZIPPED = 2,  // "Move #12 board: 0{83}4..." as zip_rle writes it
+    FULL   = 3   // the board art, one line per row (what show() used to log)
+};  // endof enum class BoardLogMode
+constexpr BoardLogMode BOARD_LOG_MODE = BoardLogMode::MOVE;
+
 inline bool is_digit(char c) {
     return c <= '9' and c >= '0';
 }
@@ -211,7 +273,7 @@ inline GameMode print_mode_choice_help_cmd() {
     std::string gamemode;
     signed char mode = -1;
     while (mode < 0) {
-        std::cin >> gamemode;
+        gamemode = InputPoller::get().next_word(-1).value_or("");  // eof: default
         if (gamemode.size() == 0) {
             return GameMode::PVE;
         }
@@ -251,7 +313,7 @@ inline BoardSize print_size_choice_help_cmd() {
     std::string boardsize;
     signed char size = -1;
     while (size < 0) {
-        std::cin >> boardsize;
+        boardsize = InputPoller::get().next_word(-1).value_or("");
         if (boardsize.size() == 0) {
             return BoardSize::Small;
         }
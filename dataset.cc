@@ -0,0 +1,86 @@
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <fstream>
+#include "common.hpp"
+#include "ArchiveReader.hpp"
+#include "Dataset.hpp"
+
+namespace mfwu {
+
+constexpr const char* archive_dir = "./archive/";
+
+void print_usage() {
+    std::cerr << "usage: ./arcE [-d] [-s size] [-c chunk_rows] output.gbds [input.arc|input.seg ...]\n"
+              << "    -d  drop positions seen before (symmetry normalized)\n"
+              << "    -s  board size to export, default: the first game's size\n"
+              << "    -c  rows per chunk, default: " << DatasetWriter::default_chunk_rows << "\n"
+              << "    inputs default to every .arc/.seg file in " << archive_dir << "\n";
+}
+
+}  // endof namespace mfwu
+
+int main(int argc, char** argv) {
+    bool dedup = false;
+    size_t size = 0;
+    size_t chunk_rows = mfwu::DatasetWriter::default_chunk_rows;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-d") {
+            dedup = true;
+        } else if (arg == "-s" && i + 1 < argc) {
+            size = atol(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            chunk_rows = atol(argv[++i]);
+        } else if (arg[0] == '-') {
+            mfwu::print_usage();
+            return -1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        mfwu::print_usage();
+        return -1;
+    }
+    std::string out_filename = args[0];
+    std::vector<std::string> in_filenames(args.begin() + 1, args.end());
+    if (in_filenames.empty()) {
+        in_filenames = mfwu::ArchiveFile::list_dir(mfwu::archive_dir);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<mfwu::DatasetWriter> writer = nullptr;
+    size_t broken_frames = 0;
+    for (const std::string& in_filename : in_filenames) {
+        mfwu::ArchiveFile file(in_filename);
+        if (!file.is_open()) {
+            std::cerr << "cannot open " << in_filename << ", skipped\n";
+            continue;
+        }
+        mfwu::ArchiveReader reader(file.stream());
+        mfwu::ArchiveGame game;
+        while (reader.next(game)) {
+            if (writer == nullptr) {
+                if (size == 0) { size = game.size; }
+                writer = std::make_unique<mfwu::DatasetWriter>(out_filename, size, dedup, chunk_rows);
+            }
+            writer->append(game);
+        }
+        broken_frames += reader.get_broken_frames();
+    }
+    if (writer == nullptr) {
+        std::cerr << "no game found\n";
+        return -1;
+    }
+    writer->close();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "games: " << writer->get_games()
+              << ", skipped games: " << writer->get_skipped_games()
+              << ", positions: " << writer->get_rows()
+              << ", duplicates dropped: " << writer->get_dup_rows()
+              << ", broken frames: " << broken_frames
+              << ", " << sec << "s\n";
+    return 0;
+}
@@ -176,12 +176,42 @@ private:
 };  // endof struct Box
 
 
+// clicks from the window's own event thread, waited on by the game loop
+class ClickQueue {
+public:
+    void push(const PositionPix& pos) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            clicks_.push_back(pos);
+        }
+        cv_.notify_one();
+    }
+    // timeout_ms < 0 waits until a click comes, nullopt if none came in time
+    std::optional<PositionPix> pop(int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto ready = [this]() { return !clicks_.empty(); };
+        if (timeout_ms < 0) {
+            cv_.wait(lock, ready);
+        } else if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+            return std::nullopt;
+        }
+        PositionPix ret = clicks_.front();
+        clicks_.pop_front();
+        return ret;
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<PositionPix> clicks_;
+};  // endof class ClickQueue
+
 class Page {
 public:
     using ptr = std::shared_ptr<Page>;
     using pic_type = Box::pic_type;
     Page(PageType type, const std::string& str1="") 
-        : type_(type), description_(str1) {}
+        : type_(type), description_(str1), clicks_(std::make_shared<ClickQueue>()) {}
 
     PageType get_type() const { return type_; }
     std::string get_description() const { return description_; }
@@ -193,27 +223,28 @@ public:
             box->show();
         }
     }
-    virtual Command get_command() {
-        const PositionPix pos = wait_input();
+    // nullopt if nothing was clicked within timeout_ms
+    virtual std::optional<Command> get_command(int timeout_ms) {
+        std::optional<PositionPix> pos = clicks_->pop(timeout_ms);
+        if (!pos.has_value()) { return std::nullopt; }
         for (const typename Box::ptr& box : boxes_) {
-            if (box->encircle(pos)) {
-                return box->get_cmd(pos);
+            if (box->encircle(*pos)) {
+                return box->get_cmd(*pos);
             }
         }
         return Command{CommandType::INVALID, {}};
-    } 
+    }
+    // the window's click callback
+    void on_click(const PositionPix& pos) { clicks_->push(pos); }
     typename Box::ptr get_box(int idx) const {
         assert(0 <= idx && idx < boxes_.size());
         return boxes_[idx];
     }
 
 private:
-    PositionPix wait_input() {
-        return {};
-    }
-
     PageType type_;
     std::string description_;
+    std::shared_ptr<ClickQueue> clicks_;  // behind a pointer, pages get copied and a mutex can't
     std::vector<typename Box::ptr> boxes_;
     // recommended: std::unordered_map<std::string, typename Box::ptr> boxes_;
 };  // endof class Page
@@ -3,227 +3,657 @@
 #include <chrono>
 #include <fstream>
 #include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "common.hpp"
 #include "Displayer.hpp"
+#include "Segment.hpp"
+#include "ThreadPool.hpp"
 // #include "Logger.hpp"
 
+/*
+    inference log -> readable text
+    the input is cut into chunks at game headers ({h,w} lines), the only
+    thing a line needs from the ones before it is its game's board size,
+    so chunks are decoded on a thread pool and written in input order
+    plain files are mmap'd, segment files are decompressed as they go
+*/
+
 namespace mfwu {
 
-class LogExplainer {
+constexpr size_t chunk_bytes = 1UL << 20;  // input per task, cut at the next game after this
+constexpr size_t chunks_per_worker = 2;  // in flight, the output is ~15x the input
+
+// "<time> {h,w}"
+inline bool is_game_header(const char* p, size_t n) {
+    const char* sp = static_cast<const char*>(memchr(p, ' ', n));
+    if (sp == nullptr || sp + 1 >= p + n) { return false; }
+    return memchr(p, '\n', sp - p) == nullptr && sp[1] == '{';
+}
+
+// the first game header starting at or after from, n if there's none
+inline size_t cut_at_game(const char* data, size_t n, size_t from) {
+    for (size_t i = std::max<size_t>(from, 1); i <= n; ) {
+        const char* nl = static_cast<const char*>(memchr(data + i - 1, '\n', n - i + 1));
+        if (nl == nullptr) { return n; }
+        size_t line = nl - data + 1;
+        if (is_game_header(data + line, n - line)) { return line; }
+        i = line + 1;
+    }
+    return n;
+}
+
+struct InferChunk {
+    std::shared_ptr<const std::string> owner;  // null for mmap'd input
+    std::string_view text;
+    size_t offset = 0;  // of text in the (decompressed) input
+};  // endof struct InferChunk
+
+class InferSource {
 public:
-    LogExplainer(const std::string& in_filename,
-                 const std::string& out_filename)
-        : in_filename_(in_filename), out_filename_(out_filename),
-          ifs_(), ofs_() {
-        ifs_.open(in_filename_, std::ios::in);
-        ofs_.open(out_filename_, std::ios::out);
+    explicit InferSource(const std::string& filename) {
+        ifs_.open(filename, std::ios::in | std::ios::binary);
+        if (!ifs_.is_open()) { return ; }
+        if (Segment::is_segment(ifs_)) {
+            seg_buf_ = std::make_unique<SegmentStreamBuf>(ifs_);
+            is_.rdbuf(seg_buf_.get());
+            open_ = seg_buf_->get_status();
+            return ;
+        }
+        ifs_.close();
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { return ; }
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            size_ = st.st_size;
+            open_ = true;
+        }
+        if (size_ > 0) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                open_ = false;
+            } else {
+                map_ = static_cast<const char*>(p);
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
     }
-    ~LogExplainer() {
-        if (ifs_.is_open()) {
-            ifs_.close();
+    ~InferSource() {
+        if (map_ != nullptr) { ::munmap(const_cast<char*>(map_), size_); }
+    }
+    InferSource(const InferSource&) = delete;
+    InferSource& operator=(const InferSource&) = delete;
+
+    bool is_open() const { return open_; }
+    bool is_mapped() const { return seg_buf_ == nullptr; }
+    // the whole file, plain files only
+    std::string_view mapped() const { return std::string_view(map_, map_ ? size_ : 0); }
+    // false at the end
+    bool next(InferChunk& chunk) {
+        return seg_buf_ ? next_streamed(chunk) : next_mapped(chunk);
+    }
+
+private:
+    bool next_mapped(InferChunk& chunk) {
+        if (pos_ >= size_) { return false; }
+        size_t end = cut_at_game(map_, size_, pos_ + chunk_bytes);
+        chunk.owner.reset();
+        chunk.text = std::string_view(map_ + pos_, end - pos_);
+        chunk.offset = pos_;
+        pos_ = end;
+        return true;
+    }
+    bool next_streamed(InferChunk& chunk) {
+        std::string buf = std::move(carry_);
+        carry_.clear();
+        size_t end = 0;
+        while (true) {
+            // a game longer than a chunk just makes a longer chunk
+            end = cut_at_game(buf.data(), buf.size(), chunk_bytes);
+            if (end < buf.size() || eof_) { break; }
+            size_t old = buf.size();
+            buf.resize(old + chunk_bytes);
+            is_.read(buf.data() + old, chunk_bytes);
+            buf.resize(old + is_.gcount());
+            eof_ = static_cast<size_t>(is_.gcount()) < chunk_bytes;
         }
-        if (ofs_.is_open()) {
-            ofs_.close();
+        if (buf.empty()) { return false; }
+        carry_.assign(buf, end, std::string::npos);
+        buf.resize(end);
+        auto owner = std::make_shared<const std::string>(std::move(buf));
+        chunk.text = *owner;
+        chunk.owner = std::move(owner);
+        chunk.offset = pos_;
+        pos_ += chunk.text.size();
+        return true;
+    }
+
+    std::ifstream ifs_;
+    std::istream is_{nullptr};
+    std::unique_ptr<SegmentStreamBuf> seg_buf_ = nullptr;
+    std::string carry_;  // the next chunk's head
+    bool eof_ = false;
+
+    const char* map_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = 0;  // of the next chunk
+    bool open_ = false;
+};  // endof class InferSource
+
+// one chunk's lines to text, a decoder is the state of one thread
+class InferDecoder {
+public:
+    void decode(std::string_view text, std::string& out) {
+        while (!text.empty()) {
+            size_t nl = text.find('\n');
+            std::string_view line = text.substr(0, nl);
+            text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+            decode_line(line, out);
         }
     }
 
-    void transform() {
-        if (!ifs_.is_open()) {
-            ifs_.open(in_filename_, std::ios::in);
-            if (!ifs_.is_open()) { std::cerr << "ifs open fail\n"; return ;}
-        }
-        if (!ofs_.is_open()) {
-            ofs_.open(out_filename_, std::ios::out);
-            if (!ofs_.is_open()) { std::cerr << "ofs open fail\n"; return ;}
-        }
-        constexpr size_t bufsz = std::max(static_cast<size_t>(BoardSize::Large) * static_cast<size_t>(BoardSize::Large), 1024UL);
-        char buf[bufsz] = {};
-        while (ifs_.getline(buf, bufsz)) {
-            std::stringstream ss;
-            std::string str = buf;
-            std::vector<std::pair<size_t, size_t>> subs = get_entry_sub(str);
-            if (unlikely(subs.size() < 2)) {
-                ofs_ << "Not a valid record\n";
-                continue;
-            } else {
-                std::string_view time_str(str.data() + subs[0].first, subs[0].second - subs[0].first);
-                time_t t = atol(time_str.data()) + XQ4GB_TIMESTAMP;
-                char buffer[64];
-                tm* info = localtime(&t);
-                strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", info);
-                ss << '[' << buffer << ']';  // time
-                ss << "[INFER] ";
-                
-                auto [f, s] = subs[1];
-                if (unlikely(str[f] == '{')) {
-                    // boardsize
-                    int cidx = -1;
-                    for (int i = f; i < s; i++) {
-                        if (str[i] == ',') {
-                            cidx = i; break;
-                        }
-                    }
-                    if (cidx == -1) { 
-                        ofs_ << "Not a valid board scale\n"; 
-                        continue;
-                    }
-                    size_t board_height_ = atol(str.substr(f + 1, cidx - f - 1).data());
-                    size_t board_width_  = atol(str.substr(cidx + 1, s - cidx - 1).data());
-                    // ignore the rest entries (if existing)
-                    ss << "BoardSize : [" << board_height_ << ", " << board_width_ << "]";
-                    if (unlikely(board_height_ != board_width_)) {
-                        ofs_ << "Not a valid boardSize\n"; 
-                        size_ = 0x3F3F3F3F;
-                        continue;
-                    }
-                    size_ = board_height_;
-                    switch (size_) {
-                    case static_cast<size_t>(BoardSize::Small) : {
-                        board_ = std::make_unique<InferDisplayer<BoardSize::Small>>(
-                            std::vector<std::vector<size_t>>(
-                                size_, std::vector<size_t>(size_)
-                            )
-                        );
-                    } break;
-                    case static_cast<size_t>(BoardSize::Middle) : {
-                        board_ = std::make_unique<InferDisplayer<BoardSize::Middle>>(
-                            std::vector<std::vector<size_t>>(
-                                size_, std::vector<size_t>(size_)
-                            )
-                        );
-                    } break;
-                    case static_cast<size_t>(BoardSize::Large) : {
-                        board_ = std::make_unique<InferDisplayer<BoardSize::Large>>(
-                            std::vector<std::vector<size_t>>(
-                                size_, std::vector<size_t>(size_)
-                            )
-                        );
-                    } break;
-                    default : {
-                        
-                    }
-                    }
-                    
-                } else {
-                    if (size_ == 0 or size_ == 0x3F3F3F3F) {
-                        // invalid size
-                        continue;
-                    } else if (size_ == static_cast<size_t>(BoardSize::Small)
-                            or size_ == static_cast<size_t>(BoardSize::Middle)
-                            or size_ == static_cast<size_t>(BoardSize::Large)) {}
-                    else {
-                        ofs_ << "Unexpected size_\n";
-                        continue;
-                    }
-                    if (unlikely(subs.size() < 3)) {
-                        ofs_ << "Not a valid infer step\n"; 
-                        continue;
-                    }
-                    size_t depth = atol(get_substr(str, subs[1]).data());
-                    ss << "[Depth = " << depth << "]";
-                    for (int i = 0; i < depth; i++) {
-                        ss << "    ";
-                    }
-                    ss << " ::: ";
-                    
-                    bool b_err = false;
-                    switch (str[subs[2].first]) {
-                    case '-' : {
-                        if (unlikely(str.size() < 6)) {
-                            ofs_ << "Not a valid option desc\n";
-                            b_err = true;
-                        }
-                        ss << "Prior pos: [" << get_substr(str, subs[3]) << ", "
-                           << get_substr(str, subs[4]) << "], score: "
-                           << get_substr(str, subs[5]);
-                    } break;
-                    case '!' : {
-                        ss << "Max depth met";
-                    } break;
-                    case '*' : {
-                        board_->unzip_tbl(std::string_view(str.data() + subs[3].first, subs[3].second - subs[3].first), true);
-                        log_board(ss, depth);
-                    } break;
-                    case ':' : {
-                        board_->unzip_tbl(std::string_view(str.data() + subs[3].first, subs[3].second - subs[3].first), false);
-                        log_board(ss, depth);
-                    } break;
-                    case '1' : {
-                        ss << "[1] Infering " << (str[subs[3].first] == 'b' ? "black" : "white")
-                           << " player's optional pos: [" << get_substr(str, subs[4]) << ", "
-                           << get_substr(str, subs[5]) << "]";
-                    } break;
-                    case '2' : {
-                        ss << "[2] Infering " << (str[subs[3].first] == 'b' ? "black" : "white")
-                           << " player's optional pos: [" << get_substr(str, subs[4]) << ", "
-                           << get_substr(str, subs[5]) << "]";
-                    } break;
-                    case '3' : {
-                        ss << "[3] Infering " << (str[subs[3].first] == 'b' ? "black" : "white")
-                           << " player's optional pos: [" << get_substr(str, subs[4]) << ", "
-                           << get_substr(str, subs[5]) << "]";
-                    } break;
-                    default : {
-                        ofs_ << "Not a valid type\n";
-                    }
-                    }
-                    if (b_err) { continue; }
+private:
+    void decode_line(std::string_view str, std::string& out) {
+        get_entry_sub(str);
+        if (unlikely(subs_.size() < 2)) {
+            out += "Not a valid record\n";
+            return ;
+        }
+        size_t line_beg = out.size();
+        append_time(out, to_long(get_substr(str, subs_[0])) + XQ4GB_TIMESTAMP);
+        out += "[INFER] ";
 
-                    ss << " ::: ";
-                }
+        auto [f, s] = subs_[1];
+        if (unlikely(at(str, f) == '{')) {
+            // boardsize
+            size_t cidx = str.find(',', f);
+            if (cidx == std::string_view::npos || cidx >= s) {
+                out.resize(line_beg);
+                out += "Not a valid board scale\n";
+                return ;
+            }
+            size_t board_height_ = to_long(str.substr(f + 1, cidx - f - 1));
+            size_t board_width_  = to_long(str.substr(cidx + 1, s - cidx - 1));
+            // ignore the rest entries (if existing)
+            if (unlikely(board_height_ != board_width_)) {
+                out.resize(line_beg);
+                out += "Not a valid boardSize\n";
+                size_ = 0x3F3F3F3F;
+                return ;
             }
-            ofs_ << ss.str() << "\n";
+            out += "BoardSize : [";
+            out += std::to_string(board_height_);
+            out += ", ";
+            out += std::to_string(board_width_);
+            out += "]\n";
+            size_ = board_height_;
+            board_ = make_board(size_);
+            return ;
+        }
+        if (size_ == 0 or size_ == 0x3F3F3F3F) {
+            // invalid size
+            out.resize(line_beg);
+            return ;
+        } else if (board_ == nullptr) {
+            out.resize(line_beg);
+            out += "Unexpected size_\n";
+            return ;
+        }
+        if (unlikely(subs_.size() < 3)) {
+            out.resize(line_beg);
+            out += "Not a valid infer step\n";
+            return ;
+        }
+        size_t depth = to_long(get_substr(str, subs_[1]));
+        out += "[Depth = ";
+        out += std::to_string(depth);
+        out += "]";
+        out.append(depth * 4, ' ');
+        out += " ::: ";
+
+        char type = at(str, subs_[2].first);
+        size_t need = type == '-' || type == '1' || type == '2' || type == '3' || type == '@' ? 6
+                    : type == '*' || type == ':' || type == '#' ? 4 : 3;
+        if (unlikely(subs_.size() < need)) {
+            out.resize(line_beg);
+            out += type == '-' ? "Not a valid option desc\n" : "Not a valid infer step\n";
+            return ;
+        }
+        switch (type) {
+        case '-' : {
+            out += "Prior pos: [";
+            out += get_substr(str, subs_[3]);
+            out += ", ";
+            out += get_substr(str, subs_[4]);
+            out += "], score: ";
+            out += get_substr(str, subs_[5]);
+        } break;
+        case '!' : {
+            out += "Max depth met";
+        } break;
+        case '*' : {
+            board_->unzip_tbl(get_substr(str, subs_[3]), true);
+            log_board(out, depth);
+        } break;
+        case ':' : {
+            board_->unzip_tbl(get_substr(str, subs_[3]), false);
+            log_board(out, depth);
+        } break;
+        case '#' : {
+            if (unlikely(!board_->unpack_tbl(get_substr(str, subs_[3])))) {
+                out.resize(line_beg);
+                out += "Not a valid packed board\n";
+                return ;
+            }
+            log_board(out, depth);
+        } break;
+        case '@' : {
+            out += "[@] Searching ";
+            out += at(str, subs_[3].first) == 'b' ? "black" : "white";
+            out += " player's move ";
+            out += get_substr(str, subs_[4]);
+            out += ", depth ";
+            out += get_substr(str, subs_[5]);
+        } break;
+        case '1' : case '2' : case '3' : {
+            out += '[';
+            out += type;
+            out += "] Infering ";
+            out += at(str, subs_[3].first) == 'b' ? "black" : "white";
+            out += " player's optional pos: [";
+            out += get_substr(str, subs_[4]);
+            out += ", ";
+            out += get_substr(str, subs_[5]);
+            out += "]";
+        } break;
+        default : {
+            // the message goes before the half-made line
+            out.insert(line_beg, "Not a valid type\n");
+        }
         }
-        ofs_.flush();
+        out += " ::: \n";
     }
-private:
-    static std::vector<std::pair<size_t, size_t>> get_entry_sub(const std::string& str) {
-        std::vector<std::pair<size_t, size_t>> ret;
-        int last_idx = 0;
-        for (int i = 0; i < str.size(); i++) {
+
+    void get_entry_sub(std::string_view str) {
+        subs_.clear();
+        size_t last_idx = 0;
+        for (size_t i = 0; i < str.size(); i++) {
             if (str[i] == ' ') {
-                ret.emplace_back(last_idx, i);
+                subs_.emplace_back(last_idx, i);
                 last_idx = i + 1;
             }
         }
-        ret.emplace_back(last_idx, str.size());
-        return ret;
+        subs_.emplace_back(last_idx, str.size());
     }
-    // TODO: use string_view?
-    static std::string get_substr(const std::string& str, const std::pair<size_t, size_t>& sub) {
+    // an empty field sits at the end of the line, std::string gave a 0 there
+    static char at(std::string_view str, size_t i) {
+        return i < str.size() ? str[i] : '\0';
+    }
+    static std::string_view get_substr(std::string_view str, const std::pair<size_t, size_t>& sub) {
         return str.substr(sub.first, sub.second - sub.first);
     }
+    // atol without the terminating 0
+    static long to_long(std::string_view str) {
+        long ret = 0;
+        bool neg = !str.empty() && str[0] == '-';
+        for (size_t i = neg; i < str.size() && is_digit(str[i]); i++) {
+            ret = ret * 10 + (str[i] - '0');
+        }
+        return neg ? -ret : ret;
+    }
+    // any size the engine plays, one displayer for all of them
+    static std::unique_ptr<Displayer_base_base> make_board(size_t size) {
+        if (!is_valid_board_size(size)) { return nullptr; }
+        std::vector<std::vector<size_t>> empty(size, std::vector<size_t>(size));
+        return std::make_unique<InferDisplayer<BoardSize::Dynamic>>(empty);
+    }
 
-    static std::string get_log_space(size_t depth) {
-        //                 [2025-04-01 20:19:28][INFER] [Depth = 0] 
-        std::string ret = "                                        ";
-        for (int i = 0; i < depth; i++) {
-            ret += "    ";
+    // a second's worth of lines share one localtime
+    void append_time(std::string& out, time_t t) {
+        if (t != time_cached_ || time_str_.empty()) {
+            char buffer[64];
+            tm info;
+            localtime_r(&t, &info);
+            size_t n = strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", &info);
+            time_str_.assign(1, '[');
+            time_str_.append(buffer, n);
+            time_str_ += ']';
+            time_cached_ = t;
         }
-        return ret;
+        out += time_str_;
     }
 
-    void log_board(std::stringstream& ss, size_t depth) {
-        ss << "Deduction board :::\n";
+    void log_board(std::string& out, size_t depth) {
+        out += "Deduction board :::\n";
         const auto& board = board_->get_framework();
-        for (int i = 0; i < board.size(); i++) {
-            const auto& line = board[i];
-            ss << get_log_space(depth);
-            ss << " ::: " << line;
+        for (size_t i = 0; i < board.size(); i++) {
+            //                 [2025-04-01 20:19:28][INFER] [Depth = 0]
+            out.append(40 + depth * 4, ' ');
+            out += " ::: ";
+            out += board[i];
             if (likely(i != board.size() - 1)) {
-                ss << " ::: \n";
+                out += " ::: \n";
             }
         }
     }
-    
-
-    std::ifstream ifs_;
-    std::ofstream ofs_;
-    std::string in_filename_, out_filename_;
 
+    std::vector<std::pair<size_t, size_t>> subs_;  // reused by every line
     size_t size_ = 0;
-
     std::unique_ptr<Displayer_base_base> board_ = nullptr;
+    time_t time_cached_ = 0;
+    std::string time_str_;
+};  // endof class InferDecoder
+
+/*
+    where the games and decisions of a plain .inf file start, kept next to
+    it as <input>.idx (text, one entry per line):
+        infidx 1 <input bytes>
+        g <offset> <length> <board size>
+        d <game> <ply> <b|w> <depth> <offset> <length>
+    a decision is one root search, from its '@' line to the next '@' or
+    game header; iterative deepening logs one per depth, all on the same ply
+    logs from before the '@' lines index their games only
+*/
+struct InferGame {
+    size_t offset = 0;
+    size_t length = 0;
+    size_t size = 0;  // board size
+};  // endof struct InferGame
+
+struct InferDecision {
+    size_t game = 0;
+    size_t ply = 0;  // stones on the board
+    char color = 'b';
+    int depth = 0;
+    size_t offset = 0;
+    size_t length = 0;
+};  // endof struct InferDecision
+
+class InferIndex {
+public:
+    static constexpr int version = 1;
+
+    static std::string path_for(const std::string& in_filename) { return in_filename + ".idx"; }
+
+    const std::vector<InferGame>& games() const { return games_; }
+    const std::vector<InferDecision>& decisions() const { return decisions_; }
+    size_t get_input_bytes() const { return input_bytes_; }
+
+    // false if it's missing, broken or made for another length of the input
+    bool load(const std::string& filename, size_t input_bytes) {
+        std::ifstream ifs(filename);
+        std::string magic;
+        int ver = 0;
+        size_t bytes = 0;
+        if (!(ifs >> magic >> ver >> bytes) || magic != "infidx" || ver != version || bytes != input_bytes) {
+            return false;
+        }
+        games_.clear();
+        decisions_.clear();
+        std::string tag;
+        while (ifs >> tag) {
+            if (tag == "g") {
+                InferGame g;
+                if (!(ifs >> g.offset >> g.length >> g.size)) { return false; }
+                games_.push_back(g);
+            } else if (tag == "d") {
+                InferDecision d;
+                if (!(ifs >> d.game >> d.ply >> d.color >> d.depth >> d.offset >> d.length)) { return false; }
+                decisions_.push_back(d);
+            } else {
+                return false;
+            }
+        }
+        input_bytes_ = bytes;
+        return true;
+    }
+    bool save(const std::string& filename) const {
+        std::string out = "infidx " + std::to_string(version) + ' ' + std::to_string(input_bytes_) + '\n';
+        for (const InferGame& g : games_) {
+            out += "g " + std::to_string(g.offset) + ' ' + std::to_string(g.length)
+                 + ' ' + std::to_string(g.size) + '\n';
+        }
+        for (const InferDecision& d : decisions_) {
+            out += "d " + std::to_string(d.game) + ' ' + std::to_string(d.ply) + ' ' + d.color
+                 + ' ' + std::to_string(d.depth) + ' ' + std::to_string(d.offset)
+                 + ' ' + std::to_string(d.length) + '\n';
+        }
+        std::ofstream ofs(filename, std::ios::out | std::ios::trunc);
+        ofs.write(out.data(), out.size());
+        return ofs.good();
+    }
+
+    // one pass over a plain file, chunks scanned on the pool
+    void build(InferSource& src, size_t workers) {
+        games_.clear();
+        decisions_.clear();
+        input_bytes_ = src.mapped().size();
+        ThreadPool pool(workers);
+        std::deque<std::future<Part>> pending;
+        auto merge_front = [this, &pending]() {
+            Part part = pending.front().get();
+            pending.pop_front();
+            size_t game_base = games_.size();
+            games_.insert(games_.end(), part.games.begin(), part.games.end());
+            for (InferDecision& d : part.decisions) {
+                if (d.game == no_game) {
+                    if (game_base == 0) { continue; }  // ahead of the first header, no board size
+                    d.game = game_base - 1;  // can't happen with chunks cut at games
+                } else {
+                    d.game += game_base;
+                }
+                decisions_.push_back(d);
+            }
+        };
+        InferChunk chunk;
+        while (src.next(chunk)) {
+            pending.push_back(pool.submit([chunk]() { return scan(chunk.text, chunk.offset); }));
+            if (pending.size() >= pool.size() * chunks_per_worker) { merge_front(); }
+        }
+        while (!pending.empty()) { merge_front(); }
+        // a game runs to the next one, a decision to the next one in its game
+        for (size_t i = 0; i < games_.size(); i++) {
+            size_t end = i + 1 < games_.size() ? games_[i + 1].offset : input_bytes_;
+            games_[i].length = end - games_[i].offset;
+        }
+        for (size_t i = 0; i < decisions_.size(); i++) {
+            InferDecision& d = decisions_[i];
+            const InferGame& g = games_[d.game];
+            size_t end = i + 1 < decisions_.size() && decisions_[i + 1].game == d.game
+                       ? decisions_[i + 1].offset : g.offset + g.length;
+            d.length = end - d.offset;
+        }
+    }
+
+    // [beg, end) of a decision, of all its depths if depth < 0
+    // plies only grow within a game, unless a takeback came in between: the first run wins
+    bool find(size_t game, size_t ply, int depth, size_t& beg, size_t& end) const {
+        auto it = std::lower_bound(decisions_.begin(), decisions_.end(), game,
+            [](const InferDecision& d, size_t g) { return d.game < g; });
+        for (; it != decisions_.end() && it->game == game && it->ply != ply; ++it) {}
+        bool found = false;
+        for (; it != decisions_.end() && it->game == game && it->ply == ply; ++it) {
+            if (depth >= 0 && it->depth != depth) { continue; }
+            if (!found) { beg = it->offset; }
+            end = it->offset + it->length;
+            found = true;
+        }
+        return found;
+    }
+
+private:
+    static constexpr size_t no_game = static_cast<size_t>(-1);
+
+    struct Part {
+        std::vector<InferGame> games;
+        std::vector<InferDecision> decisions;  // game: in this part, or no_game
+    };  // endof struct Part
+
+    // "<time> {h,w}" and "<time> <depth> @ <b|w> <ply> <depth>", the rest is skipped
+    static Part scan(std::string_view text, size_t offset) {
+        Part part;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t nl = text.find('\n', pos);
+            if (nl == std::string_view::npos) { nl = text.size(); }
+            std::string_view line = text.substr(pos, nl - pos);
+            size_t sp = line.find(' ');
+            if (sp != std::string_view::npos && sp + 1 < line.size()) {
+                if (line[sp + 1] == '{') {
+                    InferGame g;
+                    g.offset = offset + pos;
+                    g.size = atol_view(line.substr(sp + 2));
+                    part.games.push_back(g);
+                } else {
+                    size_t sp2 = line.find(' ', sp + 1);
+                    if (sp2 != std::string_view::npos && line.compare(sp2, 3, " @ ") == 0) {
+                        InferDecision d;
+                        d.game = part.games.empty() ? no_game : part.games.size() - 1;
+                        std::istringstream ss(std::string(line.substr(sp2 + 3)));
+                        if (ss >> d.color >> d.ply >> d.depth) {
+                            d.offset = offset + pos;
+                            part.decisions.push_back(d);
+                        }
+                    }
+                }
+            }
+            pos = nl + 1;
+        }
+        return part;
+    }
+    static size_t atol_view(std::string_view str) {
+        size_t ret = 0;
+        for (size_t i = 0; i < str.size() && is_digit(str[i]); i++) { ret = ret * 10 + (str[i] - '0'); }
+        return ret;
+    }
+
+    size_t input_bytes_ = 0;
+    std::vector<InferGame> games_;
+    std::vector<InferDecision> decisions_;
+};  // endof class InferIndex
+
+class LogExplainer {
+public:
+    // out_filename "": std::cout
+    LogExplainer(const std::string& in_filename,
+                 const std::string& out_filename,
+                 size_t workers=std::thread::hardware_concurrency())
+        : in_filename_(in_filename), out_filename_(out_filename),
+          src_(in_filename), ofs_(), workers_(std::max<size_t>(workers, 1)) {
+        if (!out_filename_.empty()) {
+            ofs_.open(out_filename_, std::ios::out | std::ios::binary);
+        }
+    }
+    ~LogExplainer() {
+        if (ofs_.is_open()) {
+            ofs_.close();
+        }
+    }
+
+    size_t get_in_bytes() const { return in_bytes_; }
+    size_t get_out_bytes() const { return out_bytes_; }
+    const InferIndex& get_index() const { return index_; }
+
+    void transform() {
+        if (!src_.is_open()) { std::cerr << "ifs open fail\n"; return ; }
+        if (!open_out()) { return ; }
+        ThreadPool pool(workers_);
+        std::deque<std::future<std::string>> pending;
+        auto write_front = [this, &pending]() {
+            std::string out = pending.front().get();
+            pending.pop_front();
+            write(out);
+        };
+        InferChunk chunk;
+        while (src_.next(chunk)) {
+            in_bytes_ += chunk.text.size();
+            pending.push_back(pool.submit([chunk]() {
+                // every chunk but the first starts with a game header,
+                // so a fresh decoder is all the state it needs
+                InferDecoder decoder;
+                std::string out;
+                out.reserve(chunk.text.size() * 16);
+                decoder.decode(chunk.text, out);
+                return out;
+            }));
+            if (pending.size() >= workers_ * chunks_per_worker) { write_front(); }
+        }
+        while (!pending.empty()) { write_front(); }
+        out().flush();
+    }
+
+    // the index of the input, loaded if it's up to date, else built and saved
+    // rebuild: build it anyway
+    bool index(bool rebuild=false) {
+        if (!src_.is_open()) { std::cerr << "ifs open fail\n"; return false; }
+        if (!src_.is_mapped()) {
+            std::cerr << "index: plain .inf files only, a segment can't be read from the middle\n";
+            return false;
+        }
+        std::string idx_filename = InferIndex::path_for(in_filename_);
+        if (!rebuild && index_.load(idx_filename, src_.mapped().size())) { return true; }
+        index_.build(src_, workers_);
+        in_bytes_ = src_.mapped().size();
+        if (!index_.save(idx_filename)) {
+            std::cerr << "cannot write " << idx_filename << ", the index is rebuilt next time\n";
+        }
+        return true;
+    }
+    // one decision out of the input, by the index: its lines as they are,
+    // or rendered like transform() does, boards drawn by InferDisplayer
+    // depth < 0: every depth searched for it
+    bool query(size_t game, size_t ply, int depth, bool render) {
+        if (!index()) { return false; }
+        size_t beg = 0, end = 0;
+        if (!index_.find(game, ply, depth, beg, end)) {
+            std::cerr << "no decision for game " << game << " ply " << ply;
+            if (depth >= 0) { std::cerr << " depth " << depth; }
+            std::cerr << " in " << in_filename_ << "\n";
+            return false;
+        }
+        if (!open_out()) { return false; }
+        std::string_view file = src_.mapped();
+        std::string_view text = file.substr(beg, end - beg);
+        in_bytes_ = text.size();
+        if (!render) {
+            write(text);
+        } else {
+            // the game's header first, for its board size
+            std::string_view header = file.substr(index_.games()[game].offset);
+            header = header.substr(0, header.find('\n'));
+            InferDecoder decoder;
+            std::string out;
+            decoder.decode(header, out);
+            decoder.decode(text, out);
+            write(out);
+        }
+        out().flush();
+        return true;
+    }
+
+private:
+    std::ostream& out() { return out_filename_.empty() ? std::cout : ofs_; }
+    bool open_out() {
+        if (out_filename_.empty() || ofs_.is_open()) { return true; }
+        ofs_.open(out_filename_, std::ios::out | std::ios::binary);
+        if (!ofs_.is_open()) { std::cerr << "ofs open fail\n"; return false; }
+        return true;
+    }
+    void write(std::string_view str) {
+        out().write(str.data(), str.size());
+        out_bytes_ += str.size();
+    }
+
+    std::string in_filename_, out_filename_;
+    InferSource src_;
+    std::ofstream ofs_;
+    size_t workers_;
+    InferIndex index_;
+    size_t in_bytes_ = 0;
+    size_t out_bytes_ = 0;
 };  // endof class LogExplainer
 
 constexpr const char* dir = "./inference/";
@@ -237,7 +667,7 @@ std::string get_default_input_file_path() {
     for (const auto& file : std::filesystem::directory_iterator(dir)) {
         if (file.is_regular_file() && file.path().extension().string() == std::string(".inf")) {
             auto this_time = std::filesystem::last_write_time(file.path());
-            if (this_time > last_time 
+            if (this_time > last_time
                 || last_time == std::filesystem::file_time_type{}) {
                 last_time = this_time;
                 path = file;
@@ -268,25 +698,82 @@ std::string get_default_output_file_path() {
     return path;
 }
 
+void print_usage() {
+    std::cerr << "usage: ./logE [-j workers] [input_file_path] [output_file_path]\n"
+              << "       ./logE [-j workers] -i [input_file_path]\n"
+              << "       ./logE -q game:ply[:depth] [-r] [input_file_path] [output_file_path]\n"
+              << "    input defaults to the newest .inf in " << dir << "\n"
+              << "    -i  (re)build the index <input>.idx, list its decisions:\n"
+              << "        game ply color depth offset bytes\n"
+              << "    -q  one decision's search tree by the index (built if it's missing or old),\n"
+              << "        0-based game, ply = stones on the board, every depth if it's left out\n"
+              << "        raw lines to stdout (or the output file), -r renders them with the boards\n";
+}
+
 }  // endof namespace mfwu
 
 int main(int argc, char** argv) {
     std::string in_filename, out_filename;
-    if (argc == 1) {
-        in_filename = mfwu::get_default_input_file_path();
-        out_filename = mfwu::get_default_output_file_path();
-    } else if (argc == 2) {
-        in_filename = argv[1];
+    size_t workers = std::thread::hardware_concurrency();
+    bool build_index = false, render = false;
+    std::string query;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            workers = atol(argv[++i]);
+        } else if (arg == "-i") {
+            build_index = true;
+        } else if (arg == "-q" && i + 1 < argc) {
+            query = argv[++i];
+        } else if (arg == "-r") {
+            render = true;
+        } else if (arg[0] == '-') {
+            mfwu::print_usage();
+            return -1;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() > 2 || (build_index && args.size() > 1)) {
+        std::cerr << "wrong arg count\n";
+        mfwu::print_usage();
+        return -1;
+    }
+    in_filename = args.size() > 0 ? args[0] : mfwu::get_default_input_file_path();
+    if (args.size() > 1) {
+        out_filename = args[1];
+    } else if (!build_index && query.empty()) {
         out_filename = mfwu::get_default_output_file_path();
-    } else if (argc == 3) {
-        in_filename = argv[1];
-        out_filename = argv[2];
+    }  // else std::cout
+
+    auto start = std::chrono::steady_clock::now();
+    mfwu::LogExplainer loge(in_filename, out_filename, workers);
+    if (build_index) {
+        if (!loge.index(true)) { return -1; }
+        const mfwu::InferIndex& index = loge.get_index();
+        for (const mfwu::InferDecision& d : index.decisions()) {
+            std::cout << d.game << ' ' << d.ply << ' ' << d.color << ' ' << d.depth << ' '
+                      << d.offset << ' ' << d.length << '\n';
+        }
+        std::cerr << "games: " << index.games().size() << ", decisions: " << index.decisions().size() << ", ";
+    } else if (!query.empty()) {
+        size_t game = 0, ply = 0;
+        int depth = -1;
+        if (sscanf(query.c_str(), "%lu:%lu:%d", &game, &ply, &depth) < 2) {
+            mfwu::print_usage();
+            return -1;
+        }
+        if (!loge.query(game, ply, depth, render)) { return -1; }
     } else {
-        std::cerr << "wrong arg count\n";
-        std::cerr << "usage: ./log [input_file_path] [output_file_path]\n"; 
+        loge.transform();
     }
-    mfwu::LogExplainer loge(in_filename, out_filename);
-    loge.transform();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mb = loge.get_in_bytes() / double(1 << 20);
+    std::cerr << std::fixed << std::setprecision(2)
+              << in_filename << ": " << mb << " MB in, "
+              << loge.get_out_bytes() / double(1 << 20) << " MB out, "
+              << sec << "s, " << (sec > 0 ? mb / sec : 0) << " MB/s\n";
     return 0;
 }
 
@@ -5,6 +5,7 @@
 #endif // __GUI_MODE__
 
 #define __LOG_INFERENCE_ELSEWHERE__
+#define __ARCHIVE_SEGMENT__  // compressed rolling archive instead of one .arc per game controller
 
 #include "GameController.hpp"
 #include <cstdlib>
@@ -106,8 +107,8 @@ int main() {
                 case GameStatus::NORMAL : {
                     std::cout << HELPER_PRESS_ANY_KEY << "\n";
                     game->abrupt_flush(status);
-                    sleep(1);  // TODO: del this after transfering to win platf
-                    fgetc(stdin);
+                    InputPoller::get().discard();  // keys hit while the game ended
+                    InputPoller::get().next_line(-1);
                     game->reset_game_init();
                 } break;
                 case GameStatus::MENU : {
@@ -0,0 +1,332 @@
+#define __HEADLESS_MODE__  // no std output, only warnings go to ./log
+#define __LOG_INFERENCE_ELSEWHERE__  // and inference goes nowhere
+#define __LOG_MIN_LEVEL__ 3  // WARN and up, debug and inference calls compile to nothing
+
+#include "ChessBoard.hpp"
+#include "RobotPlayer.hpp"
+#include "SparseBoard.hpp"
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+/*
+    robot vs robot match harness
+    plays pairs of games from the same random opening with colors
+    swapped (like reset_game_init does between games), on forked workers,
+    and stops as soon as the SPRT on the pair scores decides:
+        H0: elo(A - B) <= elo0,  H1: elo(A - B) >= elo1
+    a pair is one sample (0, .25, .5, .75, 1 for A), the two games of a
+    pair are far from independent, so counting them apart would lie
+    -s 0 plays on an infinite SparseBoard, sizes past max_board_size on a
+    bounded one; with no edge to fill up, a game is a draw after max_plies
+*/
+
+namespace mfwu {
+
+constexpr size_t max_plies = 400;  // SparseBoard games only
+
+struct MatchOptions {
+    size_t size = static_cast<size_t>(BoardSize::Small);
+    int workers = std::max(1U, std::thread::hardware_concurrency());
+    size_t max_pairs = 2000;
+    size_t min_pairs = 8;  // no verdict before this
+    int opening_plies = 2;
+    double elo0 = 0, elo1 = 10;
+    double alpha = 0.05, beta = 0.05;
+    uint32_t seed = static_cast<uint32_t>(time(0));
+    HumanLikeConfig config[2];  // A, B
+};  // endof struct MatchOptions
+
+// what a worker sends back for each pair, small enough for an atomic write
+struct PairResult {
+    uint32_t pair;
+    int8_t score[2];  // for A: 1 win, 0 draw, -1 loss; game 0 A is black
+};  // endof struct PairResult
+
+// random stones around the center, black first
+std::vector<Position> make_opening(const MatchOptions& opt, size_t pair) {
+    std::mt19937 rng(opt.seed * 2654435761U + pair);
+    int c = (opt.size ? static_cast<int>(opt.size) : SparseBoard::unbounded_side) / 2;
+    std::uniform_int_distribution<int> dist(c - 2, c + 2);
+    std::vector<Position> ret;
+    while ((int)ret.size() < opt.opening_plies) {
+        Position pos{dist(rng), dist(rng)};
+        if (std::find(ret.begin(), ret.end(), pos) == ret.end()) { ret.push_back(pos); }
+    }
+    return ret;
+}
+
+// winner's real status, 0 for a draw
+size_t play_game(const MatchOptions& opt, const HumanLikeConfig& black,
+                 const HumanLikeConfig& white, const std::vector<Position>& opening) {
+    std::shared_ptr<ChessBoard_base> board;
+    if (opt.size == 0 || opt.size > max_board_size) {
+        board = std::make_shared<SparseBoard>(opt.size);
+    } else {
+        board = make_headless_board(opt.size);
+    }
+    if (board == nullptr) { return 0; }
+    HumanLikeRobot players[2] = {
+        HumanLikeRobot(board, Piece::Color::Black, black),
+        HumanLikeRobot(board, Piece::Color::White, white)
+    };
+    int turn = 0;
+    for (const Position& pos : opening) {
+        board->update(Piece(pos, players[turn].get_color_const()));
+        turn ^= 1;
+    }
+    size_t plies = opening.size();
+    while (!board->is_full() && !(board->is_sparse() && plies++ >= max_plies)) {
+        if (players[turn].play() != CommandType::PIECE) { break; }
+        count_res_4 res;
+        board->count_dir(board->get_last_piece(), &res);
+        if (std::max({res.left_right, res.up_down,
+                      res.up_left_down_right, res.up_right_down_left}) >= NoPtW - 1) {
+            return Piece::get_real_status(players[turn].get_color_const());
+        }
+        turn ^= 1;
+    }
+    return 0;
+}
+
+// worker `idx` plays pairs idx, idx + workers, ... until killed or done
+void worker_task(const MatchOptions& opt, int idx, int fd) {
+    const size_t black = static_cast<size_t>(Piece::Color::Black);
+    for (size_t pair = idx; pair < opt.max_pairs; pair += opt.workers) {
+        std::vector<Position> opening = make_opening(opt, pair);
+        PairResult res{static_cast<uint32_t>(pair), {0, 0}};
+        for (int g = 0; g < 2; g++) {
+            srand(opt.seed + 2 * pair + g);  // robots break ties with rand()
+            size_t winner = play_game(opt, opt.config[g], opt.config[g ^ 1], opening);
+            if (winner == 0) { continue; }
+            bool a_is_black = g == 0;
+            res.score[g] = (winner == black) == a_is_black ? 1 : -1;
+        }
+        if (write(fd, &res, sizeof(res)) != sizeof(res)) { break; }
+    }
+}
+
+class MatchStats {
+public:
+    void add(const PairResult& res) {
+        for (int8_t s : res.score) {
+            if (s > 0) { wins_++; } else if (s < 0) { losses_++; } else { draws_++; }
+        }
+        penta_[res.score[0] + res.score[1] + 2]++;
+        pairs_++;
+    }
+    size_t get_pairs() const { return pairs_; }
+    size_t get_games() const { return pairs_ * 2; }
+
+    // A's score per game
+    double mean() const {
+        if (pairs_ == 0) { return 0.5; }
+        double sum = 0;
+        for (int k = 0; k < 5; k++) { sum += penta_[k] * k / 4.0; }
+        return sum / pairs_;
+    }
+    // of the pair score, floored: a few identical pairs are not certainty
+    double var() const {
+        if (pairs_ == 0) { return var_floor; }
+        double m = mean(), sum = 0;
+        for (int k = 0; k < 5; k++) { sum += penta_[k] * (k / 4.0 - m) * (k / 4.0 - m); }
+        return std::max(sum / pairs_, var_floor);
+    }
+    // normal approximation of the log likelihood ratio
+    double llr(double elo0, double elo1) const {
+        double s0 = score(elo0), s1 = score(elo1);
+        return pairs_ * (s1 - s0) * (2 * mean() - s0 - s1) / (2 * var());
+    }
+    double elo() const { return elo(mean()); }
+    // 95% interval
+    std::pair<double, double> elo_bounds() const {
+        double d = 1.96 * std::sqrt(var() / std::max<size_t>(pairs_, 1));
+        return {elo(mean() - d), elo(mean() + d)};
+    }
+    std::string wdl() const {
+        return std::to_string(wins_) + "-" + std::to_string(draws_) + "-" + std::to_string(losses_);
+    }
+    std::string pentanomial() const {
+        std::string ret = "[";
+        for (int k = 0; k < 5; k++) { ret += std::to_string(penta_[k]) + (k < 4 ? " " : "]"); }
+        return ret;
+    }
+
+    static double score(double elo) { return 1 / (1 + std::pow(10, -elo / 400)); }
+    static double elo(double score) {
+        score = std::clamp(score, 1e-3, 1 - 1e-3);
+        return -400 * std::log10(1 / score - 1);
+    }
+
+private:
+    static constexpr double var_floor = 0.01;
+    std::array<size_t, 5> penta_ = {};
+    size_t pairs_ = 0, wins_ = 0, draws_ = 0, losses_ = 0;
+};  // endof class MatchStats
+
+// "depth=2,op=0.6,next=0.2,choices=3", missing keys keep their defaults
+bool parse_config(const std::string& str, HumanLikeConfig& config) {
+    std::stringstream ss(str);
+    std::string kv;
+    while (std::getline(ss, kv, ',')) {
+        size_t eq = kv.find('=');
+        if (eq == std::string::npos) { return false; }
+        std::string key = kv.substr(0, eq);
+        double val = atof(kv.c_str() + eq + 1);
+        if (key == "depth") { config.depth = static_cast<int>(val); }
+        else if (key == "op") { config.op_weight = static_cast<float>(val); }
+        else if (key == "next") { config.next_weight = static_cast<float>(val); }
+        else if (key == "choices") { config.choices = static_cast<int>(val); }
+        else { return false; }
+    }
+    return config.depth >= 0 && config.choices > 0;
+}
+
+std::string describe(const HumanLikeConfig& c) {
+    std::stringstream ss;
+    ss << "depth=" << c.depth << ",op=" << c.op_weight
+       << ",next=" << c.next_weight << ",choices=" << c.choices;
+    return ss.str();
+}
+
+void print_usage() {
+    MatchOptions def;
+    std::cerr << "usage: ./match [options] -a CONFIG -b CONFIG\n"
+              << "    CONFIG   e.g. depth=2,op=0.6,next=0.2,choices=3 (default: " << describe(def.config[0]) << ")\n"
+              << "    -s size  board size, 7 to 32, default " << def.size << "\n"
+              << "             past 32 a sparse board, 0 an infinite one (" << max_plies << " plies, then a draw)\n"
+              << "    -j n     workers, default " << def.workers << "\n"
+              << "    -n n     max pairs, default " << def.max_pairs << "\n"
+              << "    -o n     random opening plies, default " << def.opening_plies << "\n"
+              << "    -e e0 e1 SPRT bounds in elo (A - B), default " << def.elo0 << " " << def.elo1 << "\n"
+              << "    -p a b   SPRT alpha beta, default " << def.alpha << " " << def.beta << "\n"
+              << "    -r seed  default: time\n";
+}
+
+}  // endof namespace mfwu
+
+int main(int argc, char** argv) {
+    using namespace mfwu;
+    MatchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if ((arg == "-a" || arg == "-b") && i + 1 < argc) {
+            ok = parse_config(argv[++i], opt.config[arg == "-b"]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            opt.size = atol(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            opt.workers = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-n" && i + 1 < argc) {
+            opt.max_pairs = atol(argv[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            opt.opening_plies = std::clamp(atoi(argv[++i]), 0, 20);
+        } else if (arg == "-e" && i + 2 < argc) {
+            opt.elo0 = atof(argv[++i]);
+            opt.elo1 = atof(argv[++i]);
+        } else if (arg == "-p" && i + 2 < argc) {
+            opt.alpha = atof(argv[++i]);
+            opt.beta = atof(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            opt.seed = static_cast<uint32_t>(atol(argv[++i]));
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            print_usage();
+            return -1;
+        }
+    }
+    if (opt.size != 0 && opt.size < min_board_size) {
+        print_usage();
+        return -1;
+    }
+    const double lower = std::log(opt.beta / (1 - opt.alpha));
+    const double upper = std::log((1 - opt.beta) / opt.alpha);
+    std::cout << "A: " << describe(opt.config[0]) << "\n"
+              << "B: " << describe(opt.config[1]) << "\n"
+              << "SPRT elo [" << opt.elo0 << ", " << opt.elo1 << "], llr bounds ["
+              << std::setprecision(3) << lower << ", " << upper << "], seed " << opt.seed << "\n";
+
+    std::vector<pid_t> pids;
+    std::vector<pollfd> fds;
+    for (int idx = 0; idx < opt.workers; idx++) {
+        int pipefd[2];
+        if (pipe(pipefd) != 0) {
+            std::cerr << "pipe fails\n";
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(pipefd[0]);
+            worker_task(opt, idx, pipefd[1]);
+            _exit(0);  // skip the parent's destructors
+        }
+        close(pipefd[1]);
+        if (pid < 0) {
+            std::cerr << "fork fails\n";
+            close(pipefd[0]);
+            break;
+        }
+        pids.push_back(pid);
+        fds.push_back(pollfd{pipefd[0], POLLIN, 0});
+    }
+    if (pids.empty()) { return -1; }
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    MatchStats stats;
+    double llr = 0;
+    std::string verdict = "inconclusive, max pairs reached";
+    size_t alive = fds.size();
+    while (alive) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        bool done = false;
+        for (pollfd& p : fds) {
+            if (p.fd < 0 || !(p.revents & (POLLIN | POLLHUP))) { continue; }
+            PairResult res;
+            if (read(p.fd, &res, sizeof(res)) != sizeof(res)) {  // worker finished
+                close(p.fd);
+                p.fd = -1;
+                alive--;
+                continue;
+            }
+            stats.add(res);
+            llr = stats.llr(opt.elo0, opt.elo1);
+            if (stats.get_pairs() >= opt.min_pairs && (llr <= lower || llr >= upper)) {
+                verdict = llr >= upper ? "H1 accepted, A is stronger" : "H0 accepted, A is not stronger";
+                done = true;
+                break;
+            }
+        }
+        auto [lo, hi] = stats.elo_bounds();
+        std::cerr << std::fixed << std::setprecision(1)
+                  << "\rpairs " << stats.get_pairs() << "  W-D-L " << stats.wdl()
+                  << "  elo " << stats.elo() << " [" << lo << ", " << hi << "]"
+                  << std::setprecision(2) << "  llr " << llr
+                  << std::setprecision(1) << "  " << stats.get_games() / elapsed() << " games/s   "
+                  << std::flush;
+        if (done) { break; }
+    }
+    std::cerr << "\n";
+    for (pid_t pid : pids) { kill(pid, SIGKILL); }  // whatever they are playing is not needed
+    for (pid_t pid : pids) { waitpid(pid, nullptr, 0); }
+    for (pollfd& p : fds) { if (p.fd >= 0) { close(p.fd); } }
+
+    auto [lo, hi] = stats.elo_bounds();
+    std::cout << std::fixed << std::setprecision(1)
+              << "games: " << stats.get_games() << " (" << stats.get_pairs() << " pairs)"
+              << ", A W-D-L: " << stats.wdl()
+              << ", pairs " << stats.pentanomial() << "\n"
+              << "elo (A - B): " << stats.elo() << " [" << lo << ", " << hi << "]"
+              << std::setprecision(2) << ", llr: " << llr << "\n"
+              << std::setprecision(1) << elapsed() << "s, "
+              << stats.get_games() / elapsed() << " games/s\n"
+              << verdict << "\n";
+    return 0;
+}
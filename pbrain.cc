@@ -0,0 +1,234 @@
+#define __HEADLESS_MODE__  // stdout belongs to the protocol, only warnings go to ./log
+#define __LOG_INFERENCE_ELSEWHERE__  // and inference goes nowhere
+#define __LOG_MIN_LEVEL__ 3  // WARN and up, debug and inference calls compile to nothing
+
+#include "ChessBoard.hpp"
+#include "RobotPlayer.hpp"
+
+/*
+    HumanLikeRobot behind the Gomocup (Piskvork) engine protocol,
+    for local tournament managers: one command per line on stdin,
+    coordinates are "x,y" = "col,row", 0-based
+        START n / RESTART / BEGIN / TURN x,y / BOARD ... DONE / TAKEBACK x,y
+        INFO key value / ABOUT / END
+    any board size from 7 to 32 (15 and 20 included), others get ERROR
+
+    time: every move is searched by iterative deepening against a deadline
+    out of timeout_turn and time_left; max_memory is taken note of only,
+    the search holds a handful of boards and is far below any limit
+*/
+
+namespace mfwu {
+
+constexpr int engine_max_depth = 8;  // time decides long before this
+
+// one game, in the engine's own colors: the robot is always Black here,
+// freestyle scoring doesn't care who moved first
+// the board is whatever make_headless_board has for the size,
+// so one Engine serves them all
+class Engine {
+public:
+    explicit Engine(std::shared_ptr<ChessBoard_base> board)
+        : board_(board), robot_(board_, Piece::Color::Black, make_config()) {}
+
+    size_t size() const { return board_->size(); }
+    void reset() {
+        board_->reset();
+        moves_.clear();
+    }
+    // false if off the board or taken
+    bool put(const Position& pos, bool own) {
+        if (!board_->is_valid_pos(pos.row, pos.col) || board_->get_status(pos.row, pos.col)) {
+            return false;
+        }
+        Piece p(pos, own ? Piece::Color::Black : Piece::Color::White);
+        moves_.emplace_back(p);
+        board_->update(p);
+        return true;
+    }
+    // the board can't lift a stone, so it is played again without it
+    bool take(const Position& pos) {
+        auto it = std::find_if(moves_.begin(), moves_.end(), [&pos](PackedMove p) {
+            return p.row() == pos.row && p.col() == pos.col;
+        });
+        if (it == moves_.end()) { return false; }
+        moves_.erase(it);
+        board_->reset();
+        for (PackedMove p : moves_) { board_->update(p.to_piece()); }
+        return true;
+    }
+    // the robot's move, already on the board, [-1, -1] if it has none
+    Position think(HumanLikeRobot::clock_type::time_point deadline) {
+        robot_.set_deadline(deadline);
+        if (robot_.play() != CommandType::PIECE) { return {}; }
+        const Piece& p = board_->get_last_piece();
+        moves_.emplace_back(p.row, p.col, Piece::Color::Black);
+        return {p.row, p.col};
+    }
+    int get_last_depth() const { return robot_.get_last_depth(); }
+
+private:
+    static HumanLikeConfig make_config() {
+        HumanLikeConfig config;
+        config.depth = engine_max_depth;
+        return config;
+    }
+
+    std::shared_ptr<ChessBoard_base> board_;  // a HeadlessBoard
+    HumanLikeRobot robot_;
+    std::vector<PackedMove> moves_;  // real colors, in order
+};  // endof class Engine
+
+inline std::unique_ptr<Engine> make_engine(size_t size) {
+    std::shared_ptr<ChessBoard_base> board = make_headless_board(size);
+    if (board == nullptr) { return nullptr; }
+    return std::make_unique<Engine>(board);
+}
+
+// the protocol's limits, in ms, 0 for "not given"
+struct EngineLimits {
+    long timeout_turn = 30000;  // protocol default
+    long timeout_match = 0;
+    long time_left = 0;
+    long max_memory = 0;
+};  // endof struct EngineLimits
+
+class PBrain {
+public:
+    int run() {
+        while (true) {
+            std::optional<std::string> line = InputPoller::get().next_line(-1);
+            if (!line.has_value()) { return 0; }  // the manager is gone
+            if (!handle(*line)) { return 0; }
+        }
+    }
+
+private:
+    using clock_type = HumanLikeRobot::clock_type;
+
+    // false on END
+    bool handle(std::string line) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) { line.pop_back(); }
+        std::istringstream ss(line);
+        std::string cmd;
+        ss >> cmd;
+        toupper(cmd);
+        if (cmd.empty()) { return true; }
+        if (cmd == "START") {
+            size_t size = 0;
+            ss >> size;
+            engine_ = make_engine(size);
+            if (engine_ == nullptr) {
+                say("ERROR unsupported size, the robot plays " + std::to_string(min_board_size)
+                    + " to " + std::to_string(max_board_size));
+                return true;
+            }
+            say("OK");
+        } else if (cmd == "RESTART") {
+            if (!check_started()) { return true; }
+            engine_->reset();
+            say("OK");
+        } else if (cmd == "BEGIN") {
+            if (!check_started()) { return true; }
+            answer();
+        } else if (cmd == "TURN") {
+            if (!check_started()) { return true; }
+            std::optional<Position> pos = parse_pos(ss);
+            if (!pos.has_value() || !engine_->put(*pos, false)) {
+                say("ERROR bad move: " + line);
+                return true;
+            }
+            answer();
+        } else if (cmd == "BOARD") {
+            if (!check_started()) { return true; }
+            engine_->reset();
+            while (true) {
+                std::optional<std::string> row = InputPoller::get().next_line(-1);
+                if (!row.has_value()) { return false; }
+                std::string str = *row;
+                toupper(str);
+                if (str.rfind("DONE", 0) == 0) { break; }
+                std::replace(str.begin(), str.end(), ',', ' ');
+                std::istringstream rs(str);
+                int x = -1, y = -1, who = 0;
+                rs >> x >> y >> who;
+                if (who == 1 || who == 2) {
+                    if (!engine_->put(Position{y, x}, who == 1)) { say("ERROR bad stone: " + *row); }
+                }
+            }
+            answer();
+        } else if (cmd == "TAKEBACK") {
+            if (!check_started()) { return true; }
+            std::optional<Position> pos = parse_pos(ss);
+            if (!pos.has_value() || !engine_->take(*pos)) {
+                say("ERROR bad takeback: " + line);
+                return true;
+            }
+            say("OK");
+        } else if (cmd == "INFO") {
+            std::string key;
+            long val = 0;
+            ss >> key >> val;
+            if (key == "timeout_turn") { limits_.timeout_turn = val; }
+            else if (key == "timeout_match") { limits_.timeout_match = val; }
+            else if (key == "time_left") { limits_.time_left = val; }
+            else if (key == "max_memory") { limits_.max_memory = val; }
+            // rule, game_type, folder...: freestyle only, nothing to keep
+        } else if (cmd == "ABOUT") {
+            say("name=\"mfwu-gobang\", version=\"1.0\", author=\"xq4\"");
+        } else if (cmd == "END") {
+            return false;
+        } else {
+            say("UNKNOWN " + cmd);
+        }
+        return true;
+    }
+
+    void answer() {
+        auto start = clock_type::now();
+        Position pos = engine_->think(start + budget());
+        if (pos.row < 0 || pos.col < 0) {
+            say("ERROR no move left");
+            return ;
+        }
+        long ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count();
+        say("MESSAGE depth " + std::to_string(engine_->get_last_depth()) + ", " + std::to_string(ms) + " ms");
+        say(std::to_string(pos.col) + "," + std::to_string(pos.row));
+    }
+    // this move's share of the clock, minus a margin for the manager's own lag
+    clock_type::duration budget() const {
+        long ms = limits_.timeout_turn > 0 ? limits_.timeout_turn : 100;  // 0: as fast as it can
+        if (limits_.timeout_match > 0 && limits_.time_left > 0) {
+            ms = std::min(ms, limits_.time_left / 15);
+        }
+        ms -= std::max(30L, ms / 20);
+        return std::chrono::milliseconds(std::max(ms, 1L));
+    }
+    bool check_started() {
+        if (engine_ == nullptr) { say("ERROR no START yet"); }
+        return engine_ != nullptr;
+    }
+    // "x,y" -> [y, x]
+    static std::optional<Position> parse_pos(std::istringstream& ss) {
+        std::string str;
+        ss >> str;
+        size_t comma = str.find(',');
+        if (comma == std::string::npos) { return std::nullopt; }
+        int x = atoi(str.substr(0, comma).c_str());
+        int y = atoi(str.substr(comma + 1).c_str());
+        return Position{y, x};
+    }
+    static void say(const std::string& str) {
+        std::cout << str << std::endl;
+    }
+
+    std::unique_ptr<Engine> engine_;
+    EngineLimits limits_;
+};  // endof class PBrain
+
+}  // endof namespace mfwu
+
+int main() {
+    mfwu::PBrain brain;
+    return brain.run();
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <chrono>
+#include "common.hpp"
+#include "ArchiveReader.hpp"
+#include "PositionStore.hpp"
+
+namespace mfwu {
+
+constexpr const char* archive_dir = "./archive/";
+constexpr size_t max_continuations = 10;
+
+void print_usage() {
+    std::cerr << "usage: ./posS build [-s size] store.gbps [input.arc|input.seg ...]\n"
+              << "       ./posS add store.gbps input.arc|input.seg ...\n"
+              << "       ./posS query store.gbps [moves ...]\n"
+              << "       ./posS stat store.gbps\n"
+              << "    build starts over, add appends games to an existing store\n"
+              << "    build inputs default to every .arc/.seg file in " << archive_dir << "\n"
+              << "    moves are typed as in the game (\"hh\", \"hi\"...), black first\n";
+}
+
+void print_entry(const PositionStore::Entry& e) {
+    size_t finished = e.black_wins + e.white_wins + e.draws;
+    std::cout << "visits: " << e.visits
+              << ", black: " << e.black_wins
+              << ", white: " << e.white_wins
+              << ", draws: " << e.draws;
+    if (finished) {
+        std::cout << std::fixed << std::setprecision(1)
+                  << " (black " << 100.0 * e.black_wins / finished << "%)";
+    }
+    std::cout << "\n";
+}
+
+// "hh" -> row * size + col, -1 if it's off the board
+int parse_move(const std::string& mv, size_t size) {
+    if (mv.size() != 2) { return -1; }
+    int rc[2];
+    for (int k = 0; k < 2; k++) {
+        char ch = mv[k];
+        rc[k] = is_lowercase(ch) ? ch - 'a' : is_uppercase(ch) ? ch - 'A' : -1;
+        if (rc[k] < 0 || rc[k] >= (int)size) { return -1; }
+    }
+    return rc[0] * size + rc[1];
+}
+
+int ingest(PositionStore& store, const std::vector<std::string>& in_filenames) {
+    auto start = std::chrono::steady_clock::now();
+    size_t games = 0, skipped = 0;
+    for (const std::string& in_filename : in_filenames) {
+        ArchiveFile file(in_filename);
+        if (!file.is_open()) {
+            std::cerr << "cannot open " << in_filename << ", skipped\n";
+            continue;
+        }
+        ArchiveReader reader(file.stream());
+        ArchiveGame game;
+        while (reader.next(game)) {
+            if (store.add_game(game)) { games++; }
+            else { skipped++; }
+            if (!store.get_status()) { return -1; }
+        }
+    }
+    store.sync();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "games: " << games << ", skipped games: " << skipped
+              << ", positions: " << store.get_entries()
+              << ", capacity: " << store.get_capacity()
+              << ", " << sec << "s\n";
+    return 0;
+}
+
+int query(PositionStore& store, const std::vector<std::string>& moves) {
+    size_t size = store.get_size();
+    std::vector<uint8_t> board(size * size, 0);
+    size_t color = static_cast<size_t>(Piece::Color::Black);
+    for (const std::string& mv : moves) {
+        int i = parse_move(mv, size);
+        if (i < 0 || board[i]) {
+            std::cerr << "bad move: " << mv << "\n";
+            return -1;
+        }
+        board[i] = color;
+        color = color == static_cast<size_t>(Piece::Color::Black)
+                ? static_cast<size_t>(Piece::Color::White)
+                : static_cast<size_t>(Piece::Color::Black);
+    }
+    const PositionStore::Entry* e = store.lookup(board);
+    if (e == nullptr) {
+        std::cout << "position not found\n";
+        return 0;
+    }
+    print_entry(*e);
+    // what was played from here, symmetric replies share one entry
+    std::vector<std::pair<const PositionStore::Entry*, size_t>> next;
+    std::unordered_set<uint64_t> seen;
+    for (size_t i = 0; i < size * size; i++) {
+        if (board[i]) { continue; }
+        board[i] = color;
+        const PositionStore::Entry* child = store.lookup(board);
+        if (child && seen.insert(child->key).second) { next.emplace_back(child, i); }
+        board[i] = 0;
+    }
+    std::sort(next.begin(), next.end(), [](const auto& a, const auto& b) {
+        return a.first->visits > b.first->visits;
+    });
+    if (next.size() > max_continuations) { next.resize(max_continuations); }
+    for (auto&& [child, i] : next) {
+        std::cout << "  " << static_cast<char>('a' + i / size)
+                  << static_cast<char>('a' + i % size) << "  ";
+        print_entry(*child);
+    }
+    return 0;
+}
+
+}  // endof namespace mfwu
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        mfwu::print_usage();
+        return -1;
+    }
+    std::string mode = argv[1];
+    size_t size = 0;
+    std::vector<std::string> args;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) {
+            size = atol(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        mfwu::print_usage();
+        return -1;
+    }
+    std::string store_filename = args[0];
+    std::vector<std::string> rest(args.begin() + 1, args.end());
+
+    if (mode == "build") {
+        if (rest.empty()) { rest = mfwu::ArchiveFile::list_dir(mfwu::archive_dir); }
+        if (size == 0) {  // the first game decides
+            for (const std::string& in_filename : rest) {
+                mfwu::ArchiveFile file(in_filename);
+                mfwu::ArchiveReader reader(file.stream());
+                mfwu::ArchiveGame game;
+                if (file.is_open() && reader.next(game)) {
+                    size = game.size;
+                    break;
+                }
+            }
+        }
+        if (size == 0 || size > mfwu::BoardHash::max_size) {
+            std::cerr << "no game found\n";
+            return -1;
+        }
+        mfwu::PositionStore store(store_filename, size, false, true);
+        if (!store.get_status()) { return -1; }
+        return mfwu::ingest(store, rest);
+    } else if (mode == "add") {
+        mfwu::PositionStore store(store_filename, 0);
+        if (!store.get_status()) { return -1; }
+        return mfwu::ingest(store, rest);
+    } else if (mode == "query") {
+        mfwu::PositionStore store(store_filename, 0, true);
+        if (!store.get_status()) { return -1; }
+        return mfwu::query(store, rest);
+    } else if (mode == "stat") {
+        mfwu::PositionStore store(store_filename, 0, true);
+        if (!store.get_status()) { return -1; }
+        std::cout << "board: " << store.get_size() << "x" << store.get_size()
+                  << ", games: " << store.get_games()
+                  << ", positions: " << store.get_entries()
+                  << ", capacity: " << store.get_capacity() << "\n";
+        return 0;
+    }
+    mfwu::print_usage();
+    return -1;
+}
@@ -0,0 +1,101 @@
+#define __HEADLESS_MODE__  // no std output, only warnings go to ./log
+#define __LOG_INFERENCE_ELSEWHERE__  // and inference goes nowhere
+#define __LOG_MIN_LEVEL__ 3  // WARN and up, debug and inference calls compile to nothing
+#define __LOG_THREAD_ID__  // sessions log from the worker pool
+#define __ARCHIVE_SEGMENT__  // every session's games in the run's segment
+
+#include "GameServer.hpp"
+#include <signal.h>
+
+/*
+    game server: many sessions, one process
+        ./serv -p 5555              tcp on 127.0.0.1:5555
+        ./serv -u /tmp/gobang.sock  unix socket
+    then e.g. `nc 127.0.0.1 5555` and type HELP
+*/
+
+namespace mfwu {
+
+GameServer* running_server = nullptr;
+
+void on_signal(int) {
+    if (running_server) { running_server->stop(); }
+}
+
+void print_usage() {
+    ServerOptions def;
+    std::cerr << "usage: serv [-p port] [-u path] [options]\n"
+              << "    -h host  tcp address, default " << def.tcp_host << "\n"
+              << "    -p port  tcp port, default: no tcp\n"
+              << "    -u path  unix socket, default: none\n"
+              << "    -j n     robot search workers, default " << def.workers << "\n"
+              << "    -m n     max sessions, default " << def.max_sessions << "\n"
+              << "    -f policy[,param]  archive fsync: never, batch, games,N or interval,MS\n"
+              << "             default: never\n";
+}
+
+// "games,10" -> GAMES, 10
+bool parse_fsync(const std::string& str, FsyncPolicy& policy, size_t& param) {
+    size_t comma = str.find(',');
+    std::string name = str.substr(0, comma);
+    param = comma == std::string::npos ? 0 : atol(str.c_str() + comma + 1);
+    if (name == "never") { policy = FsyncPolicy::NEVER; }
+    else if (name == "batch") { policy = FsyncPolicy::BATCH; }
+    else if (name == "games" && param > 0) { policy = FsyncPolicy::GAMES; }
+    else if (name == "interval" && param > 0) { policy = FsyncPolicy::INTERVAL; }
+    else { return false; }
+    return true;
+}
+
+}  // endof namespace mfwu
+
+int main(int argc, char** argv) {
+    using namespace mfwu;
+    ServerOptions opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" && i + 1 < argc) {
+            opt.tcp_host = argv[++i];
+        } else if (arg == "-p" && i + 1 < argc) {
+            opt.tcp_port = atoi(argv[++i]);
+        } else if (arg == "-u" && i + 1 < argc) {
+            opt.unix_path = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            opt.workers = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-m" && i + 1 < argc) {
+            opt.max_sessions = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-f" && i + 1 < argc) {
+            FsyncPolicy policy;
+            size_t param;
+            if (!parse_fsync(argv[++i], policy, param)) {
+                print_usage();
+                return -1;
+            }
+            ArchiveWriter::Instance().set_fsync_policy(policy, param);
+        } else {
+            print_usage();
+            return -1;
+        }
+    }
+    if (opt.tcp_port <= 0 && opt.unix_path.empty()) {
+        print_usage();
+        return -1;
+    }
+    GameServer server(opt);
+    if (!server.listen()) {
+        std::cerr << "server fails to start, see ./log\n";
+        return -1;
+    }
+    running_server = &server;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "serving on";
+    if (opt.tcp_port > 0) { std::cout << " " << opt.tcp_host << ":" << opt.tcp_port; }
+    if (!opt.unix_path.empty()) { std::cout << " " << opt.unix_path; }
+    std::cout << ", " << opt.workers << " workers" << std::endl;
+    server.run();
+    running_server = nullptr;
+    std::cout << "bye, " << server.get_session_num() << " sessions dropped" << std::endl;
+    return 0;
+}